@@ -0,0 +1,161 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/*
+ One set of coefficients for a chain of biquad sections, and the memory
+ of every channel that runs through it.
+
+ The EQ patches used to keep a filter object per channel, each with its
+ own copy of the coefficients, copied over from the first channel every
+ block, and its own memory, gathered into the lanes and scattered back
+ around every kernel call. A bank holds the coefficients once and the
+ memory of all channels as a structure of arrays: for each section and
+ state variable, a row of CHANNELS floats. A group of lanes loads and
+ stores its memory as whole vectors straight from those rows, and the
+ channels are walked in groups of 8, 4, 2 and then 1 for any channel
+ count, through contiguous memory.
+
+ The filter designs stay with the patches; they hand the bank b0, b1,
+ b2, a1, a2 per section with setCoeffs.
+*/
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __BiquadBank_h__
+#define __BiquadBank_h__
+
+#include <string.h>
+#include "ProfileStage.h"
+#include "BiquadLanes.h"
+#include "BiquadLookahead.h"
+#include "BiquadStateSpace.h"
+
+template<int SECTIONS, int CHANNELS>
+class BiquadBank {
+public:
+  static const int STATE_SIZE = 4*SECTIONS; // per channel
+private:
+  float coeffs[SECTIONS][5];         // b0, b1, b2, a1, a2 per section
+  float state[4*SECTIONS][CHANNELS]; // row 4*s+k: state variable k of section s
+  biquadTopology topology;
+
+  // channels ch to ch+LANES-1 as one lane group
+  template<int LANES>
+  void processLanes(int ch, float* const* buf, int numSamples){
+    if(topology == TDF2)
+      BiquadLanes<LANES>::template processCascadeTDF2<SECTIONS>(coeffs, &state[0][ch], CHANNELS,
+								 buf, numSamples);
+    else
+      BiquadLanes<LANES>::template processCascade<SECTIONS>(coeffs, &state[0][ch], CHANNELS,
+							     buf, numSamples);
+  }
+
+  template<int LANES>
+  void processRampLanes(int ch, float* const* buf, int numSamples,
+			const float* start, const float* end){
+    if(topology == TDF2)
+      BiquadLanes<LANES>::processRampTDF2(start, end, &state[0][ch], CHANNELS, buf, numSamples);
+    else
+      BiquadLanes<LANES>::processRamp(start, end, &state[0][ch], CHANNELS, buf, numSamples);
+  }
+
+public:
+  BiquadBank() : topology(DF1) {
+    memset(coeffs, 0, sizeof(coeffs));
+    clear();
+  }
+
+  void clear(){
+    memset(state, 0, sizeof(state));
+  }
+
+  // choose the structure the sections run in; this clears the memory
+  void setTopology(biquadTopology topo){
+    topology = topo;
+    clear();
+  }
+  biquadTopology getTopology(){
+    return topology;
+  }
+
+  // b0, b1, b2, a1, a2 of one section
+  void setCoeffs(int section, const float* c){
+    memcpy(coeffs[section], c, sizeof(coeffs[section]));
+  }
+  const float* getCoeffs(int section){
+    return coeffs[section];
+  }
+
+  // the memory of channel ch, section after section: x1, x2, y1, y2, or
+  // in TDF2 s1, s2 and two unused entries
+  void getStateVariables(int ch, float* out){
+    for(int r=0; r<4*SECTIONS; r++)
+      out[r] = state[r][ch];
+  }
+  void setStateVariables(int ch, const float* in){
+    for(int r=0; r<4*SECTIONS; r++)
+      state[r][ch] = in[r];
+  }
+
+  // channels 0 to channels-1 of buf, filtered in place, as many at a
+  // time as the lanes allow
+  void process(float* const* buf, int channels, int numSamples){
+    int ch = 0;
+    for(; CHANNELS >= 8 && ch+8 <= channels; ch += 8)
+      processLanes<8>(ch, buf+ch, numSamples);
+    for(; CHANNELS >= 4 && ch+4 <= channels; ch += 4)
+      processLanes<4>(ch, buf+ch, numSamples);
+    for(; ch+2 <= channels; ch += 2)
+      processLanes<2>(ch, buf+ch, numSamples);
+    for(; ch<channels; ch++)
+      processLanes<1>(ch, buf+ch, numSamples);
+  }
+
+  // the same with the coefficients ramped from start to end across the
+  // block, end being kept after; for a bank of one section
+  void processRamp(float* const* buf, int channels, int numSamples,
+		   const float* start, const float* end){
+    int ch = 0;
+    for(; CHANNELS >= 8 && ch+8 <= channels; ch += 8)
+      processRampLanes<8>(ch, buf+ch, numSamples, start, end);
+    for(; CHANNELS >= 4 && ch+4 <= channels; ch += 4)
+      processRampLanes<4>(ch, buf+ch, numSamples, start, end);
+    for(; ch+2 <= channels; ch += 2)
+      processRampLanes<2>(ch, buf+ch, numSamples, start, end);
+    for(; ch<channels; ch++)
+      processRampLanes<1>(ch, buf+ch, numSamples, start, end);
+    setCoeffs(0, end);
+  }
+
+  // channel ch on its own, STEP samples at a time in DF1, see
+  // BiquadLookahead.h; its vectors follow from the coefficients alone,
+  // so one serves every channel of the bank
+  template<int STEP>
+  void processLookahead(int ch, BiquadLookahead<SECTIONS, STEP>& lookahead,
+			float* buf, int numSamples){
+    float memory[SECTIONS][4];
+    getStateVariables(ch, memory[0]);
+    lookahead.setCoeffs(coeffs);
+    lookahead.process(memory, buf, numSamples);
+    setStateVariables(ch, memory[0]);
+  }
+
+  // channel ch as a single state space update per sample, see
+  // BiquadStateSpace.h; in TDF2, whose memory is the state. As with the
+  // lookahead, one set of matrices serves every channel.
+  void processStateSpace(int ch, BiquadStateSpace<SECTIONS>& stateSpace,
+			 float* buf, int numSamples){
+    float memory[2*SECTIONS];
+    for(int s=0; s<SECTIONS; s++){
+      memory[2*s] = state[4*s][ch];
+      memory[2*s+1] = state[4*s+1][ch];
+    }
+    stateSpace.setCoeffs(coeffs);
+    stateSpace.process(memory, buf, numSamples);
+    for(int s=0; s<SECTIONS; s++){
+      state[4*s][ch] = memory[2*s];
+      state[4*s+1][ch] = memory[2*s+1];
+    }
+  }
+};
+
+#endif // __BiquadBank_h__
@@ -0,0 +1,255 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/*
+ Biquad kernel for several channels that share one set of coefficients,
+ such as the left and right sides of a stereo EQ.
+
+ Each channel's direct form I recursion is latency bound on its own; here
+ the channels run in the lanes of one vector, so a single chain of
+ multiplies and adds advances all of them at once. The lanes are GCC
+ vector extensions: SSE on x86, NEON on ARM cores that have it, and
+ plain scalar code where there is no float SIMD (the Cortex-M4), so the
+ same source builds everywhere. Per lane the arithmetic is done in the
+ same order as the scalar filters, so results match them bit for bit.
+*/
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __BiquadLanes_h__
+#define __BiquadLanes_h__
+
+#include <string.h>
+#include "ProfileStage.h"
+
+// direct form I keeps two inputs and two outputs per section; transposed
+// direct form II keeps two partial sums, with fewer loads and stores
+enum biquadTopology {
+  DF1,
+  TDF2
+};
+
+// the vector type of each width, and a load of sample i of every lane's
+// channel; built in one initialiser, which compiles to shuffles rather
+// than one insert per lane
+template<int LANES> struct BiquadLaneVector;
+template<> struct BiquadLaneVector<1> {
+  typedef float type __attribute__((vector_size(4)));
+  static void gather(type& v, float* const* buf, int i){
+    v = (type){ buf[0][i] };
+  }
+};
+template<> struct BiquadLaneVector<2> {
+  typedef float type __attribute__((vector_size(8)));
+  static void gather(type& v, float* const* buf, int i){
+    v = (type){ buf[0][i], buf[1][i] };
+  }
+};
+template<> struct BiquadLaneVector<4> {
+  typedef float type __attribute__((vector_size(16)));
+  static void gather(type& v, float* const* buf, int i){
+    v = (type){ buf[0][i], buf[1][i], buf[2][i], buf[3][i] };
+  }
+};
+template<> struct BiquadLaneVector<8> {
+  typedef float type __attribute__((vector_size(32)));
+  static void gather(type& v, float* const* buf, int i){
+    v = (type){ buf[0][i], buf[1][i], buf[2][i], buf[3][i],
+		 buf[4][i], buf[5][i], buf[6][i], buf[7][i] };
+  }
+};
+
+// The kernels keep each lane's filter memory in rows of stride floats,
+// one row per state variable with the lanes side by side, so that a
+// lane group's memory loads and stores as whole vectors; a BiquadBank
+// keeps its channels that way. With one lane and a stride of 1 that is
+// the plain x1, x2, y1, y2 of one section after another.
+template<int LANES>
+struct BiquadLanes {
+  typedef typename BiquadLaneVector<LANES>::type Vector;
+
+  // by reference: at 8 lanes, a vector returned by value changes the
+  // ABI with AVX off
+  static void load(Vector& v, const float* row){
+    memcpy(&v, row, sizeof(v));
+  }
+  static void store(float* row, const Vector& v){
+    memcpy(row, &v, sizeof(v));
+  }
+  static void broadcast(Vector& v, float x){
+    v = (Vector){} + x;
+  }
+
+  // one direct form I section with the coefficients ramped linearly
+  // from start to end (b0, b1, b2, a1, a2) across the block, end being
+  // reached on its last sample; state: rows x1, x2, y1, y2; buf: one
+  // block of numSamples per lane, filtered in place
+  static void processRamp(const float* start, const float* end, float* state, int stride,
+			  float* const* buf, int numSamples){
+    PROFILE_STAGE("BiquadLanes::processRamp");
+    float scale = 1.0f/numSamples;
+    Vector b0, b1, b2, a1, a2, db0, db1, db2, da1, da2, x1, x2, y1, y2;
+    broadcast(b0, start[0]);
+    broadcast(b1, start[1]);
+    broadcast(b2, start[2]);
+    broadcast(a1, start[3]);
+    broadcast(a2, start[4]);
+    broadcast(db0, (end[0]-start[0])*scale);
+    broadcast(db1, (end[1]-start[1])*scale);
+    broadcast(db2, (end[2]-start[2])*scale);
+    broadcast(da1, (end[3]-start[3])*scale);
+    broadcast(da2, (end[4]-start[4])*scale);
+    load(x1, state);
+    load(x2, state+stride);
+    load(y1, state+2*stride);
+    load(y2, state+3*stride);
+    for(int i=0; i<numSamples; i++){
+      b0 += db0;
+      b1 += db1;
+      b2 += db2;
+      a1 += da1;
+      a2 += da2;
+      Vector x;
+      BiquadLaneVector<LANES>::gather(x, buf, i);
+      Vector out = b0*x+b1*x1+b2*x2-a1*y1-a2*y2;
+      y2 = y1;
+      y1 = out;
+      x2 = x1;
+      x1 = x;
+      for(int lane=0; lane<LANES; lane++)
+	buf[lane][i] = out[lane];
+    }
+    store(state, x1);
+    store(state+stride, x2);
+    store(state+2*stride, y1);
+    store(state+3*stride, y2);
+  }
+
+  // transposed direct form II, ramped as processRamp: rows s1, s2
+  static void processRampTDF2(const float* start, const float* end, float* state, int stride,
+			      float* const* buf, int numSamples){
+    PROFILE_STAGE("BiquadLanes::processRampTDF2");
+    float scale = 1.0f/numSamples;
+    Vector b0, b1, b2, a1, a2, db0, db1, db2, da1, da2, s1, s2;
+    broadcast(b0, start[0]);
+    broadcast(b1, start[1]);
+    broadcast(b2, start[2]);
+    broadcast(a1, start[3]);
+    broadcast(a2, start[4]);
+    broadcast(db0, (end[0]-start[0])*scale);
+    broadcast(db1, (end[1]-start[1])*scale);
+    broadcast(db2, (end[2]-start[2])*scale);
+    broadcast(da1, (end[3]-start[3])*scale);
+    broadcast(da2, (end[4]-start[4])*scale);
+    load(s1, state);
+    load(s2, state+stride);
+    for(int i=0; i<numSamples; i++){
+      b0 += db0;
+      b1 += db1;
+      b2 += db2;
+      a1 += da1;
+      a2 += da2;
+      Vector x;
+      BiquadLaneVector<LANES>::gather(x, buf, i);
+      Vector out = b0*x+s1;
+      s1 = b1*x-a1*out+s2;
+      s2 = b2*x-a2*out;
+      for(int lane=0; lane<LANES; lane++)
+	buf[lane][i] = out[lane];
+    }
+    store(state, s1);
+    store(state+stride, s2);
+  }
+
+  // a chain of SECTIONS direct form I sections in one pass: each sample
+  // goes through all of them in registers, one load and one store per
+  // sample instead of one per section. A section's inputs are the
+  // previous section's outputs, so x1, x2 are kept once for the chain
+  // and the later sections' x1, x2 are written back from those outputs.
+  // coeffs: b0, b1, b2, a1, a2 per section; state: rows x1, x2, y1, y2
+  // per section
+  template<int SECTIONS>
+  static void processCascade(const float (*coeffs)[5], float* state, int stride,
+			     float* const* buf, int numSamples){
+    PROFILE_STAGE("BiquadLanes::processCascade");
+    Vector b0[SECTIONS], b1[SECTIONS], b2[SECTIONS], a1[SECTIONS], a2[SECTIONS];
+    Vector y1[SECTIONS], y2[SECTIONS];
+    for(int s=0; s<SECTIONS; s++){
+      broadcast(b0[s], coeffs[s][0]);
+      broadcast(b1[s], coeffs[s][1]);
+      broadcast(b2[s], coeffs[s][2]);
+      broadcast(a1[s], coeffs[s][3]);
+      broadcast(a2[s], coeffs[s][4]);
+      load(y1[s], state+(4*s+2)*stride);
+      load(y2[s], state+(4*s+3)*stride);
+    }
+    Vector x1, x2;
+    load(x1, state);
+    load(x2, state+stride);
+    for(int i=0; i<numSamples; i++){
+      Vector x;
+      BiquadLaneVector<LANES>::gather(x, buf, i);
+      Vector in1 = x1, in2 = x2;
+      x2 = x1;
+      x1 = x;
+#pragma GCC unroll 16
+      for(int s=0; s<SECTIONS; s++){
+	Vector out = b0[s]*x+b1[s]*in1+b2[s]*in2-a1[s]*y1[s]-a2[s]*y2[s];
+	in1 = y1[s];
+	in2 = y2[s];
+	y2[s] = y1[s];
+	y1[s] = out;
+	x = out;
+      }
+      for(int lane=0; lane<LANES; lane++)
+	buf[lane][i] = x[lane];
+    }
+    store(state, x1);
+    store(state+stride, x2);
+    for(int s=0; s<SECTIONS; s++){
+      if(s > 0){
+	store(state+4*s*stride, y1[s-1]);
+	store(state+(4*s+1)*stride, y2[s-1]);
+      }
+      store(state+(4*s+2)*stride, y1[s]);
+      store(state+(4*s+3)*stride, y2[s]);
+    }
+  }
+
+  // the same for transposed direct form II sections, which share no
+  // state: rows s1, s2 per section, at the places of x1, x2
+  template<int SECTIONS>
+  static void processCascadeTDF2(const float (*coeffs)[5], float* state, int stride,
+				 float* const* buf, int numSamples){
+    PROFILE_STAGE("BiquadLanes::processCascadeTDF2");
+    Vector b0[SECTIONS], b1[SECTIONS], b2[SECTIONS], a1[SECTIONS], a2[SECTIONS];
+    Vector s1[SECTIONS], s2[SECTIONS];
+    for(int s=0; s<SECTIONS; s++){
+      broadcast(b0[s], coeffs[s][0]);
+      broadcast(b1[s], coeffs[s][1]);
+      broadcast(b2[s], coeffs[s][2]);
+      broadcast(a1[s], coeffs[s][3]);
+      broadcast(a2[s], coeffs[s][4]);
+      load(s1[s], state+4*s*stride);
+      load(s2[s], state+(4*s+1)*stride);
+    }
+    for(int i=0; i<numSamples; i++){
+      Vector x;
+      BiquadLaneVector<LANES>::gather(x, buf, i);
+#pragma GCC unroll 16
+      for(int s=0; s<SECTIONS; s++){
+	Vector out = b0[s]*x+s1[s];
+	s1[s] = b1[s]*x-a1[s]*out+s2[s];
+	s2[s] = b2[s]*x-a2[s]*out;
+	x = out;
+      }
+      for(int lane=0; lane<LANES; lane++)
+	buf[lane][i] = x[lane];
+    }
+    for(int s=0; s<SECTIONS; s++){
+      store(state+4*s*stride, s1[s]);
+      store(state+(4*s+1)*stride, s2[s]);
+    }
+  }
+};
+
+#endif // __BiquadLanes_h__
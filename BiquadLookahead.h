@@ -0,0 +1,145 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/*
+ Block-parallel kernel for a mono cascade of direct form I biquads.
+
+ One channel gives no lanes to spread over, and in the sample by sample
+ recursion every output waits on the one before. Looking STEP samples
+ ahead, though, the next STEP outputs of a section are a linear function
+ of its STEP inputs and its x1, x2, y1, y2 at the start of the step:
+
+   y[0..STEP-1] = sum over j of in[j]*col[j]
+		  + x1*fx1 + x2*fx2 + y1*fy1 + y2*fy2
+
+ with vectors col, fx1 ... that depend on the coefficients only. That is
+ STEP+4 vector multiply-adds per STEP samples, all independent of each
+ other except through y1, y2, so the recursion advances STEP samples
+ per trip instead of one. The vectors are found by running STEP samples
+ of the section from each unit input and unit state, and are rebuilt
+ only when the coefficients change.
+
+ The filter memory is the usual DF1 one, so the sectioned kernels can
+ pick it up at any point; the sums are done in another order, so the
+ output matches them to rounding rather than bit for bit. Worth it only
+ where float vectors are: on a core without, it is STEP+4 multiplies
+ per sample per section instead of 5.
+*/
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __BiquadLookahead_h__
+#define __BiquadLookahead_h__
+
+#include <string.h>
+#include "ProfileStage.h"
+#include "BiquadLanes.h"
+
+template<int SECTIONS, int STEP>
+class BiquadLookahead {
+private:
+  typedef typename BiquadLaneVector<STEP>::type Vector; // STEP of 2, 4 or 8
+  Vector col[SECTIONS][STEP]; // what input j adds to the outputs of a step
+  Vector fx1[SECTIONS], fx2[SECTIONS], fy1[SECTIONS], fy2[SECTIONS];
+  float cascade[SECTIONS][5]; // b0, b1, b2, a1, a2 the vectors are built from
+  bool valid;
+
+  // STEP samples of one section from in and its memory
+  static void run(const float* coeffs, const float* in, float x1, float x2,
+		  float y1, float y2, Vector& out){
+    for(int i=0; i<STEP; i++){
+      float y = coeffs[0]*in[i]+coeffs[1]*x1+coeffs[2]*x2-coeffs[3]*y1-coeffs[4]*y2;
+      x2 = x1;
+      x1 = in[i];
+      y2 = y1;
+      y1 = y;
+      out[i] = y;
+    }
+  }
+
+public:
+  BiquadLookahead() : valid(false) {}
+
+  // coeffs: b0, b1, b2, a1, a2 per section, in the order they run
+  void setCoeffs(const float (*coeffs)[5]){
+    if(valid && memcmp(cascade, coeffs, sizeof(cascade)) == 0)
+      return;
+    memcpy(cascade, coeffs, sizeof(cascade));
+    valid = true;
+    for(int s=0; s<SECTIONS; s++){
+      float in[STEP] = {};
+      for(int j=0; j<STEP; j++){
+	in[j] = 1.f;
+	run(cascade[s], in, 0.f, 0.f, 0.f, 0.f, col[s][j]);
+	in[j] = 0.f;
+      }
+      run(cascade[s], in, 1.f, 0.f, 0.f, 0.f, fx1[s]);
+      run(cascade[s], in, 0.f, 1.f, 0.f, 0.f, fx2[s]);
+      run(cascade[s], in, 0.f, 0.f, 1.f, 0.f, fy1[s]);
+      run(cascade[s], in, 0.f, 0.f, 0.f, 1.f, fy2[s]);
+    }
+  }
+
+  // state: x1, x2, y1, y2 per section, kept as by BiquadLanes::processCascade;
+  // samples past the last whole step run one at a time
+  void process(float (*state)[4], float* buf, int numSamples){
+    PROFILE_STAGE("BiquadLookahead::process");
+    float x1 = state[0][0], x2 = state[0][1];
+    float y1[SECTIONS], y2[SECTIONS];
+    for(int s=0; s<SECTIONS; s++){
+      y1[s] = state[s][2];
+      y2[s] = state[s][3];
+    }
+    int i = 0;
+    for(; i+STEP<=numSamples; i+=STEP){
+      float* x = buf+i;
+      float in1 = x1, in2 = x2;
+      x1 = x[STEP-1];
+      x2 = x[STEP-2];
+#pragma GCC unroll 16
+      for(int s=0; s<SECTIONS; s++){
+	// odd and even terms summed apart, so that their adds overlap
+	Vector even = fx1[s]*in1+fy1[s]*y1[s];
+	Vector odd = fx2[s]*in2+fy2[s]*y2[s];
+#pragma GCC unroll 16
+	for(int j=0; j<STEP; j+=2){
+	  even += col[s][j]*x[j];
+	  odd += col[s][j+1]*x[j+1];
+	}
+	Vector y = even+odd;
+	in1 = y1[s];
+	in2 = y2[s];
+	y1[s] = y[STEP-1];
+	y2[s] = y[STEP-2];
+	memcpy(x, &y, sizeof(y));
+      }
+    }
+    for(; i<numSamples; i++){
+      float x = buf[i];
+      float in1 = x1, in2 = x2;
+      x2 = x1;
+      x1 = x;
+      for(int s=0; s<SECTIONS; s++){
+	const float* c = cascade[s];
+	float out = c[0]*x+c[1]*in1+c[2]*in2-c[3]*y1[s]-c[4]*y2[s];
+	in1 = y1[s];
+	in2 = y2[s];
+	y2[s] = y1[s];
+	y1[s] = out;
+	x = out;
+      }
+      buf[i] = x;
+    }
+    state[0][0] = x1;
+    state[0][1] = x2;
+    for(int s=0; s<SECTIONS; s++){
+      if(s > 0){
+	state[s][0] = y1[s-1];
+	state[s][1] = y2[s-1];
+      }
+      state[s][2] = y1[s];
+      state[s][3] = y2[s];
+    }
+  }
+};
+
+#endif // __BiquadLookahead_h__
@@ -0,0 +1,206 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/*
+ Fixed-point direct form I biquad: Q31 samples, state and coefficients,
+ a 64 bit accumulator, saturation on the way out. On the Cortex-M4
+ every multiply-add is one SMLAL, with no FPU state to save, and a
+ section's memory is four words either way.
+
+ Coefficients come from the float designs: BiquadQ31Coeffs takes b0,
+ b1, b2, a1, a2 as the float filters keep them and scales the five by the
+ smallest power of two that brings the sum of their magnitudes below
+ 1, which the output shift then undoes. Then no sum of five products
+ reaches 2^62, whatever the samples, and the accumulator cannot wrap. Samples carry
+ EQ_Q31_HEADROOM bits of headroom, so that a boost of the float range
+ up to 2^EQ_Q31_HEADROOM survives the cascade before it saturates.
+
+ The accumulator is cut to the output with error feedback: the bits
+ shifted out are kept and added to the next sample's sum. That leaves
+ the quantisation noise at about -6*(31-EQ_Q31_HEADROOM) dB full scale
+ instead of amplified by the noise gain of the poles, which a low shelf
+ puts near 1, and it keeps the silent tails from settling in the limit
+ cycles that plain rounding gives. Host/PatchNoise measures the floor
+ against the float filters.
+*/
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __BiquadQ31_h__
+#define __BiquadQ31_h__
+
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include "ProfileStage.h"
+
+#ifndef EQ_Q31_HEADROOM
+#define EQ_Q31_HEADROOM 4 // bits above float full scale, 24 dB
+#endif
+#define Q31_ONE 2147483648.0f
+#define Q31_SCALE (Q31_ONE/(1 << EQ_Q31_HEADROOM)) // float 1.0 in samples
+#define Q31_CHUNK 64 // samples converted at a time, on the stack
+
+// b0, b1, b2, a1, a2 of a float design in Q(31-shift), a1 and a2 negated
+class BiquadQ31Coeffs {
+private:
+  float coeffs[5]; // the float coefficients these were converted from
+  bool valid;
+
+  static int32_t saturate(int64_t x){
+    return x > INT32_MAX ? INT32_MAX : x < INT32_MIN ? INT32_MIN : (int32_t)x;
+  }
+
+public:
+  int32_t b0, b1, b2, a1, a2;
+  int shift;
+
+  BiquadQ31Coeffs() : valid(false), b0(0), b1(0), b2(0), a1(0), a2(0), shift(0) {}
+
+  // converted only if they changed
+  void set(const float* c){
+    if(valid && memcmp(coeffs, c, sizeof(coeffs)) == 0)
+      return;
+    memcpy(coeffs, c, sizeof(coeffs));
+    valid = true;
+    float sum = 0;
+    for(int k=0; k<5; k++)
+      sum += fabsf(c[k]);
+    shift = 0;
+    while(sum >= (float)(1 << shift) && shift < 8)
+      shift++;
+    float scale = Q31_ONE/(1 << shift);
+    b0 = saturate((int64_t)(c[0]*scale));
+    b1 = saturate((int64_t)(c[1]*scale));
+    b2 = saturate((int64_t)(c[2]*scale));
+    a1 = saturate((int64_t)(-c[3]*scale));
+    a2 = saturate((int64_t)(-c[4]*scale));
+  }
+};
+
+// the memory of one section on one channel
+class BiquadQ31 {
+private:
+  int32_t x1, x2, y1, y2;
+  int64_t err; // bits the last output dropped
+
+  static int32_t saturate(int64_t x){
+    return x > INT32_MAX ? INT32_MAX : x < INT32_MIN ? INT32_MIN : (int32_t)x;
+  }
+
+public:
+  BiquadQ31() : x1(0), x2(0), y1(0), y2(0), err(0) {}
+
+  void process(const BiquadQ31Coeffs& c, int32_t* buf, int numSamples){
+    PROFILE_STAGE("BiquadQ31::process");
+    // in locals: the samples are int32_t too, and could alias them
+    const int32_t b0 = c.b0, b1 = c.b1, b2 = c.b2, a1 = c.a1, a2 = c.a2;
+    const int down = 31-c.shift;
+    int32_t in1 = x1, in2 = x2, out1 = y1, out2 = y2;
+    int64_t error = err;
+    for(int i=0; i<numSamples; i++){
+      int64_t acc = (int64_t)b0*buf[i];
+      acc += (int64_t)b1*in1;
+      acc += (int64_t)b2*in2;
+      acc += (int64_t)a2*out2;
+      acc += (int64_t)a1*out1;
+      acc += error;
+      int64_t q = acc >> down;
+      error = acc - (q << down);
+      int32_t out = saturate(q);
+      in2 = in1;
+      in1 = buf[i];
+      out2 = out1;
+      out1 = out;
+      buf[i] = out;
+    }
+    x1 = in1;
+    x2 = in2;
+    y1 = out1;
+    y2 = out2;
+    err = error;
+  }
+
+  // the memory as floats that hold it exactly: x1, x2, y1, y2 as samples
+  // cut to their top 16 bits, then the 16 bits below each, then the
+  // error carried to the next sample in the same two parts. The first
+  // four are within 2^-15 of the float filters' x1, x2, y1, y2.
+  static const int STATE_SIZE = 10;
+  void getStateVariables(float* state){
+    const float sample = 1.0f/Q31_SCALE;
+    toFloats(x1, sample, state[0], state[4]);
+    toFloats(x2, sample, state[1], state[5]);
+    toFloats(y1, sample, state[2], state[6]);
+    toFloats(y2, sample, state[3], state[7]);
+    toFloats(err, 1.0f/Q31_ONE/Q31_ONE, state[8], state[9]);
+  }
+  void setStateVariables(const float* state){
+    const double sample = Q31_SCALE;
+    x1 = fromFloats(state[0], state[4], sample);
+    x2 = fromFloats(state[1], state[5], sample);
+    y1 = fromFloats(state[2], state[6], sample);
+    y2 = fromFloats(state[3], state[7], sample);
+    err = fromFloats(state[8], state[9], (double)Q31_ONE*Q31_ONE);
+  }
+
+  // a word below 2^32 as two floats of 16 significant bits each, times a
+  // power of two scale, and back
+  static void toFloats(int64_t x, float scale, float& high, float& low){
+    int64_t bits = x & 0xffff;
+    high = (float)(x-bits)*scale;
+    low = (float)bits*scale;
+  }
+  static int64_t fromFloats(float high, float low, double scale){
+    return (int64_t)(high*scale) + (int64_t)(low*scale);
+  }
+
+  static int32_t fromFloat(float x){
+    x *= Q31_SCALE;
+    return x >= Q31_ONE ? INT32_MAX : x < -Q31_ONE ? INT32_MIN : (int32_t)x;
+  }
+};
+
+// one set of Q31 coefficients for a chain of sections and the memory of
+// every channel that runs through it, as BiquadBank.h for the float
+// filters: the coefficients are converted once, not per channel
+template<int SECTIONS, int CHANNELS>
+class BiquadQ31Bank {
+private:
+  BiquadQ31Coeffs coeffs[SECTIONS];
+  BiquadQ31 state[CHANNELS][SECTIONS];
+
+public:
+  static const int STATE_SIZE = SECTIONS*BiquadQ31::STATE_SIZE; // per channel
+
+  // b0, b1, b2, a1, a2 of one section's float design
+  void setCoeffs(int section, const float* c){
+    coeffs[section].set(c);
+  }
+
+  void getStateVariables(int ch, float* out){
+    for(int s=0; s<SECTIONS; s++)
+      state[ch][s].getStateVariables(out+s*BiquadQ31::STATE_SIZE);
+  }
+  void setStateVariables(int ch, const float* in){
+    for(int s=0; s<SECTIONS; s++)
+      state[ch][s].setStateVariables(in+s*BiquadQ31::STATE_SIZE);
+  }
+
+  // channels 0 to channels-1 of buf, filtered in place, each converted in
+  // and out Q31_CHUNK samples at a time
+  void process(float* const* buf, int channels, int numSamples){
+    int32_t fixed[Q31_CHUNK];
+    for(int ch=0; ch<channels; ch++){
+      for(int j=0; j<numSamples; j+=Q31_CHUNK){
+	int n = numSamples-j < Q31_CHUNK ? numSamples-j : Q31_CHUNK;
+	for(int i=0; i<n; i++)
+	  fixed[i] = BiquadQ31::fromFloat(buf[ch][j+i]);
+	for(int s=0; s<SECTIONS; s++)
+	  state[ch][s].process(coeffs[s], fixed, n);
+	for(int i=0; i<n; i++)
+	  buf[ch][j+i] = fixed[i]*(1.0f/Q31_SCALE);
+      }
+    }
+  }
+};
+
+#endif // __BiquadQ31_h__
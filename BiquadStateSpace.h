@@ -0,0 +1,118 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/*
+ A cascade of biquad sections run as one linear system of order
+ 2*SECTIONS: per sample, next = A*state + B*in and out = C*state + D*in.
+
+ Sectioned, each sample goes through the sections one after another, a
+ chain of dependent multiplies and adds. Here the whole update is a
+ dense matrix-vector product: every column of A is independent of the
+ others, so the products run side by side in SIMD lanes and the sums
+ are added in two halves. That is roughly SECTIONS times the multiplies
+ the sections need, traded for a shorter dependency chain; whether it
+ pays depends on the vector width and FMA units of the target.
+
+ The state is the sections' transposed direct form II memory, s1 and s2
+ per section, so it carries over unchanged when the coefficients change
+ and can be handed back to TDF2 filters. The matrices are built by
+ running one sample of the sectioned cascade from each unit state and
+ from a unit input, and rebuilt only when the coefficients change.
+*/
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __BiquadStateSpace_h__
+#define __BiquadStateSpace_h__
+
+#include <string.h>
+#include "ProfileStage.h"
+
+template<int SECTIONS>
+class BiquadStateSpace {
+public:
+  static const int ORDER = 2*SECTIONS;
+private:
+  typedef float Vector __attribute__((vector_size(16)));
+  static const int ROWS = (ORDER+3)/4; // vectors per state, zero padded
+  Vector a[ORDER][ROWS]; // column j of A: what state j adds to the next state
+  Vector b[ROWS];        // B: what the input adds to it
+  Vector c[ROWS];        // C, as a row
+  float d;
+  float cascade[SECTIONS][5]; // the coefficients the matrices are built from
+  bool valid;
+
+  // one sample through the sections in TDF2, the update A, B, C and D
+  // stand for
+  static float step(const float (*coeffs)[5], float* state, float x){
+    for(int s=0; s<SECTIONS; s++){
+      float out = coeffs[s][0]*x+state[2*s];
+      state[2*s] = coeffs[s][1]*x-coeffs[s][3]*out+state[2*s+1];
+      state[2*s+1] = coeffs[s][2]*x-coeffs[s][4]*out;
+      x = out;
+    }
+    return x;
+  }
+
+public:
+  BiquadStateSpace() : valid(false) {}
+
+  // coeffs: b0, b1, b2, a1, a2 per section, in the order they run
+  void setCoeffs(const float (*coeffs)[5]){
+    if(valid && memcmp(cascade, coeffs, sizeof(cascade)) == 0)
+      return;
+    memcpy(cascade, coeffs, sizeof(cascade));
+    valid = true;
+    // column j from unit state j, and B and D from a unit input
+    for(int j=0; j<=ORDER; j++){
+      float state[ROWS*4] = {};
+      if(j < ORDER)
+	state[j] = 1.f;
+      float out = step(cascade, state, j < ORDER ? 0.f : 1.f);
+      Vector* column = j < ORDER ? a[j] : b;
+      for(int r=0; r<ROWS*4; r++)
+	column[r/4][r%4] = state[r];
+      if(j < ORDER)
+	c[j/4][j%4] = out;
+      else
+	d = out;
+    }
+    for(int j=ORDER; j<ROWS*4; j++)
+      c[j/4][j%4] = 0.f;
+  }
+
+  // state: s1, s2 per section, ORDER values
+  void process(float* state, float* buf, int numSamples){
+    PROFILE_STAGE("BiquadStateSpace::process");
+    Vector x[ROWS] = {};
+    for(int j=0; j<ORDER; j++)
+      x[j/4][j%4] = state[j];
+    for(int i=0; i<numSamples; i++){
+      float in = buf[i];
+      // out from the current state
+      Vector cx = c[0]*x[0];
+#pragma GCC unroll 16
+      for(int r=1; r<ROWS; r++)
+	cx += c[r]*x[r];
+      buf[i] = d*in+((cx[0]+cx[1])+(cx[2]+cx[3]));
+      // next state, with the odd and even columns summed apart so
+      // that their adds overlap
+      Vector next[ROWS];
+#pragma GCC unroll 16
+      for(int r=0; r<ROWS; r++){
+	Vector even = b[r]*in, odd = {};
+#pragma GCC unroll 16
+	for(int j=0; j<ORDER; j+=2){
+	  even += x[j/4][j%4]*a[j][r];
+	  odd += x[j/4][j%4+1]*a[j+1][r];
+	}
+	next[r] = even+odd;
+      }
+      for(int r=0; r<ROWS; r++)
+	x[r] = next[r];
+    }
+    for(int j=0; j<ORDER; j++)
+      state[j] = x[j/4][j%4];
+  }
+};
+
+#endif // __BiquadStateSpace_h__
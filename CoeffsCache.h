@@ -0,0 +1,68 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/*
+ Change detection for the EQ filter designs.
+
+ The EQ patches recompute their biquad coefficients every block, from a
+ frequency, a Q and a gain: cosf, sinf and up to four powf per band, most
+ of the time for knobs that have not moved. A filter keeps the inputs it
+ was last designed with in a CoeffsCache and skips the design while the
+ new ones are within knob noise of them. The comparison is against the
+ last design, not the last block, so a slow sweep still redesigns once it
+ has moved far enough.
+
+ The host tools built with COEFFS_CACHE=1 define COEFFS_CACHE_STATS to
+ count hits and misses (see Host/CoeffsCacheStats.h); everywhere else,
+ the pedal included, the counting compiles out.
+*/
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __CoeffsCache_h__
+#define __CoeffsCache_h__
+
+#include <math.h>
+
+// two steps of a 12 bit knob: relative for frequency and Q, and in dB
+// over the widest (60 dB) gain range for the gain
+#define COEFFS_CACHE_TOLERANCE (2.0f/4096)
+#define COEFFS_CACHE_TOLERANCE_DB (60*COEFFS_CACHE_TOLERANCE)
+
+#ifdef COEFFS_CACHE_STATS
+#include "CoeffsCacheStats.h"
+#define COUNT_COEFFS_CACHE(hit) CoeffsCacheStats::count(hit)
+#else
+#define COUNT_COEFFS_CACHE(hit)
+#endif
+
+class CoeffsCache {
+private:
+  float fn, q, dbGain; // inputs of the last design
+  bool valid;
+public:
+  CoeffsCache() : valid(false) {}
+
+  // true if a design from these inputs can be skipped; otherwise they are
+  // taken as the last design, which the caller then computes
+  bool matches(float normalizedFrequency, float Q, float gain){
+    bool hit = valid &&
+      fabsf(normalizedFrequency-fn) <= COEFFS_CACHE_TOLERANCE*fn &&
+      fabsf(Q-q) <= COEFFS_CACHE_TOLERANCE*q &&
+      fabsf(gain-dbGain) <= COEFFS_CACHE_TOLERANCE_DB;
+    COUNT_COEFFS_CACHE(hit);
+    if(!hit){
+      fn = normalizedFrequency;
+      q = Q;
+      dbGain = gain;
+      valid = true;
+    }
+    return hit;
+  }
+
+  // coefficients set by other means: the next design is done in full
+  void invalidate(){
+    valid = false;
+  }
+};
+
+#endif // __CoeffsCache_h__
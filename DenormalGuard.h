@@ -0,0 +1,114 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/*
+ Keeping the recursive filters out of subnormal numbers.
+
+ When the input goes silent, the biquad memories and the SVF low and band
+ states decay towards zero and pass through the subnormal range on the
+ way, where x86 takes a microcode assist on every operation: a silent
+ tail can cost many times a loud block. Two guards, for two kinds of
+ target:
+
+ DenormalScope sets flush-to-zero and denormals-are-zero for its
+ lifetime and restores the previous mode after, on x86 (MXCSR) and ARM
+ (FPSCR, FPCR). The host harness can hold one around processAudio
+ (PatchProcessor::setFlushDenormals), off unless a tool asks for it.
+
+ DenormalGuard, for targets where the mode cannot be set, adds noise
+ far below any signal (DENORMAL_NOISE, -300 dB) to a patch's input, so
+ that the states settle on it instead of decaying. It is loud enough
+ that its square, as in the power follower of VowelFilterWithTraj, is
+ still a normal number; against any signal above -140 dB it is below
+ half an ulp and changes nothing. It is compiled in with
+ DENORMAL_INJECTION=1; otherwise DenormalGuard::process is empty.
+
+ Host/PatchTail measures the cost of a silent tail with and without.
+*/
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __DenormalGuard_h__
+#define __DenormalGuard_h__
+
+#include <stdint.h>
+#if defined(__SSE__)
+#include <xmmintrin.h>
+#endif
+
+#ifndef DENORMAL_INJECTION
+#define DENORMAL_INJECTION 0 // 1: add DENORMAL_NOISE to the filter inputs
+#endif
+#define DENORMAL_NOISE 1e-15f // peak level of the injected noise
+
+class DenormalScope {
+private:
+#if defined(__SSE__)
+  typedef unsigned int Mode; // MXCSR
+  static const Mode FLUSH_BITS = 0x8040; // FTZ | DAZ
+#elif defined(__aarch64__)
+  typedef uint64_t Mode; // FPCR
+  static const Mode FLUSH_BITS = 1 << 24; // FZ
+#else
+  typedef uint32_t Mode; // FPSCR, where there is one
+  static const Mode FLUSH_BITS = 1 << 24; // FZ
+#endif
+  bool flush;
+  Mode saved;
+public:
+  // with flush false the mode is left as it is
+  DenormalScope(bool flushDenormals = true) : flush(flushDenormals), saved(0) {
+    if(!flush)
+      return;
+#if defined(__SSE__)
+    saved = _mm_getcsr();
+    _mm_setcsr(saved | FLUSH_BITS);
+#elif defined(__aarch64__)
+    __asm__ volatile("mrs %0, fpcr" : "=r"(saved));
+    __asm__ volatile("msr fpcr, %0" : : "r"(saved | FLUSH_BITS));
+#elif defined(__ARM_FP)
+    __asm__ volatile("vmrs %0, fpscr" : "=r"(saved));
+    __asm__ volatile("vmsr fpscr, %0" : : "r"(saved | FLUSH_BITS));
+#endif
+  }
+  ~DenormalScope(){
+    if(!flush)
+      return;
+#if defined(__SSE__)
+    _mm_setcsr(saved);
+#elif defined(__aarch64__)
+    __asm__ volatile("msr fpcr, %0" : : "r"(saved));
+#elif defined(__ARM_FP)
+    __asm__ volatile("vmsr fpscr, %0" : : "r"(saved));
+#endif
+  }
+};
+
+class DenormalGuard {
+#if DENORMAL_INJECTION
+private:
+  static const int LENGTH = 64;
+  float noise[LENGTH]; // repeated over each block, so that the adds vectorise
+public:
+  DenormalGuard(){
+    uint32_t seed = 0x2545f491;
+    for(int i=0; i<LENGTH; i++){
+      seed = seed*1664525u + 1013904223u;
+      noise[i] = (int32_t)seed*(DENORMAL_NOISE/2147483648.0f);
+    }
+  }
+
+  // add the noise to a block of a filter's input
+  void process(float* buf, int numSamples){
+    for(int j=0; j<numSamples; j+=LENGTH){
+      int n = numSamples-j < LENGTH ? numSamples-j : LENGTH;
+      for(int i=0; i<n; i++)
+	buf[j+i] += noise[i];
+    }
+  }
+#else
+public:
+  void process(float*, int){}
+#endif
+};
+
+#endif // __DenormalGuard_h__
@@ -0,0 +1,115 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/*
+ Float approximations of the transcendental functions used by the filter
+ designs: sin and cos of the filter angle, 10^x for the dB gains, exp and
+ log for the knob to frequency mappings.
+
+ Each reduces its argument to a short interval and evaluates a polynomial
+ fitted there (Chebyshev interpolation, near minimax). The polynomials
+ are accurate to a few 1e-9, below float resolution, so the error that
+ is left comes from the argument reduction and float rounding: a few ulp
+ over the ranges the patches use. Host/PatchMath measures it in dB and Hz
+ and times the functions against libm.
+
+ Domains: fastSin, fastCos and fastSinCos for |x| up to a few hundred
+ (the patches pass 0 to pi); fastExp2, fastPow10 and fastExp for results
+ within the normal float range; fastLog for positive normal x.
+*/
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __FastMath_h__
+#define __FastMath_h__
+
+#include <stdint.h>
+
+#define FAST_MATH_2_OVER_PI 0.636619772f
+#define FAST_MATH_PIO2_HI   1.57079637f    // pi/2 split in two for the reduction
+#define FAST_MATH_PIO2_LO   -4.37113900e-08f
+#define FAST_MATH_LN2       0.693147181f
+#define FAST_MATH_LOG2_E    1.44269504f
+#define FAST_MATH_LOG2_10   3.32192809f
+#define FAST_MATH_SQRT2     1.41421356f
+#define FAST_MATH_ROUND     12582912.0f    // 1.5*2^23: adding it rounds to an integer
+#define FAST_MATH_ROUND_BITS 0x4b400000u   // its bit pattern
+
+// sin(x)/x and cos(x) for x in [-pi/4, pi/4], as polynomials in x^2
+inline float fastSinKernel(float x){
+  float t = x*x;
+  return x*(0.9999999969f+t*(-0.1666665069f+t*(0.00833203633f+t*-0.0001950396312f)));
+}
+inline float fastCosKernel(float x){
+  float t = x*x;
+  return 1.0f+t*(-0.4999999962f+t*(0.04166661672f+t*(-0.00138866186f+t*2.437988014e-05f)));
+}
+
+// sin and cos of x from one argument reduction, as a filter design needs
+// both for the same angle. The quadrant is rounded with the 1.5*2^23
+// trick, whose low mantissa bits then hold it, so nothing branches.
+inline void fastSinCos(float x, float* s, float* c){
+  union { float f; uint32_t i; } k;
+  k.f = x*FAST_MATH_2_OVER_PI+FAST_MATH_ROUND;
+  uint32_t q = k.i;
+  float n = k.f-FAST_MATH_ROUND;
+  float r = (x-n*FAST_MATH_PIO2_HI)-n*FAST_MATH_PIO2_LO;
+  float sr = fastSinKernel(r);
+  float cr = fastCosKernel(r);
+  float sq = q & 1 ? cr : sr;
+  float cq = q & 1 ? sr : cr;
+  *s = q & 2 ? -sq : sq;
+  *c = (q+1) & 2 ? -cq : cq;
+}
+
+inline float fastSin(float x){
+  float s, c;
+  fastSinCos(x, &s, &c);
+  return s;
+}
+
+inline float fastCos(float x){
+  float s, c;
+  fastSinCos(x, &s, &c);
+  return c;
+}
+
+// 2^x: 2^n by building the exponent, 2^f for f in [-0.5, 0.5] by polynomial
+inline float fastExp2(float x){
+  x = x < -126.0f ? -126.0f : x;
+  x = x > 127.0f ? 127.0f : x;
+  union { float f; uint32_t i; } k;
+  k.f = x+FAST_MATH_ROUND;
+  float f = x-(k.f-FAST_MATH_ROUND);
+  float p = 1.0f+f*(0.6931472067f+f*(0.2402265121f+f*(0.05550327214f+
+	   f*(0.009618025603f+f*(0.001340043217f+f*0.0001546973191f)))));
+  union { uint32_t i; float f; } scale;
+  scale.i = (k.i-FAST_MATH_ROUND_BITS+127) << 23;
+  return p*scale.f;
+}
+
+inline float fastPow10(float x){
+  return fastExp2(x*FAST_MATH_LOG2_10);
+}
+
+inline float fastExp(float x){
+  return fastExp2(x*FAST_MATH_LOG2_E);
+}
+
+// log(x) = e*log(2)+log(m), m in [sqrt(1/2), sqrt(2)], and log(m) as
+// s*P(s^2) with s = (m-1)/(m+1), the atanh series refitted
+inline float fastLog(float x){
+  union { float f; uint32_t i; } bits;
+  bits.f = x;
+  int e = (int)((bits.i >> 23) & 0xff)-127;
+  bits.i = (bits.i & 0x007fffff) | 0x3f800000;
+  float m = bits.f;
+  if(m > FAST_MATH_SQRT2){
+    m *= 0.5f;
+    e++;
+  }
+  float s = (m-1.0f)/(m+1.0f);
+  float t = s*s;
+  return e*FAST_MATH_LN2+s*(1.999999999f+t*(0.6666681585f+t*(0.3997480368f+t*0.2992545239f)));
+}
+
+#endif // __FastMath_h__
@@ -29,9 +29,14 @@
 #ifndef __FormatFilterWithLFO_hpp__
 #define __FormatFilterWithLFO_hpp__
 
+#include "ProfileStage.h"
+#include "DenormalGuard.h"
+
 
 
 class SampleBasedPatch : public Patch {
+private:
+  DenormalGuard denormals; // the SVF states, see DenormalGuard.h
 public:
   virtual void prepare() = 0;
   virtual float processSample(float sample) = 0;
@@ -39,6 +44,8 @@ public:
 	prepare();
 	int size = buffer.getSize();
 	float* samples = buffer.getSamples(0); // This Class is Mono (1in, 1out)
+	denormals.process(samples, size);
+	PROFILE_STAGE("SVF bandpass loop");
 	for(int i=0; i<size; ++i){
 		samples[i] = processSample(samples[i]);
 	}
@@ -128,6 +135,25 @@ class FormantFilterWithLFO : public SampleBasedPatch {
 			overall_gain = overall_gain * overall_gain;  //max gain will be 4 => 12 dB
 		}
 			
+		//filter memory of the bandpass filters and the LFO position, for snapshot and restore
+		static const int STATE_SIZE = 8;
+		void getStateVariables(float* state) {
+			for (int i=0; i<3; i++) {
+				state[i] = low[i];
+				state[3+i] = band[i];
+			}
+			state[6] = lfo_val;
+			state[7] = lfo_sign;
+		}
+		void setStateVariables(const float* state) {
+			for (int i=0; i<3; i++) {
+				low[i] = state[i];
+				band[i] = state[3+i];
+			}
+			lfo_val = state[6];
+			lfo_sign = state[7];
+		}
+		
 		float processSample(float sample){
 			
 			//update the lfo
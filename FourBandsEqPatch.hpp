@@ -25,6 +25,40 @@
 #ifndef __FourBandsEqPatch_hpp__
 #define __FourBandsEqPatch_hpp__
 
+#include "ProfileStage.h"
+#include "BiquadLanes.h"
+#include "CoeffsCache.h"
+#include "FastMath.h"
+#include "BiquadStateSpace.h"
+#include "BiquadLookahead.h"
+#include "BiquadBank.h"
+#include "DenormalGuard.h"
+#include "BiquadQ31.h"
+
+#ifndef EQ_CHANNELS
+#define EQ_CHANNELS 2 // stereo on the pedal; hosts may build for more
+#endif
+#ifndef EQ_LOOKAHEAD
+#if defined(__SSE2__) || defined(__ARM_NEON)
+#define EQ_LOOKAHEAD 4 // samples per step of the mono kernel, see BiquadLookahead.h
+#else
+#define EQ_LOOKAHEAD 0 // no float vectors: mono runs sample by sample
+#endif
+#endif
+#ifndef EQ_FIXED_POINT
+#define EQ_FIXED_POINT 0 // 1: the bands run in Q31, see BiquadQ31.h
+#endif
+#ifndef EQ_STATE_SPACE
+#define EQ_STATE_SPACE 0 // 1: each channel's bands as one state space, see BiquadStateSpace.h
+#endif
+#ifndef EQ_TOPOLOGY
+#if EQ_STATE_SPACE
+#define EQ_TOPOLOGY TDF2 // the state space keeps the TDF2 memory of the bands
+#else
+#define EQ_TOPOLOGY DF1 // or TDF2, see BiquadLanes.h
+#endif
+#endif
+
 /*
  * 4 bands EQ Patch.
  * Controls :
@@ -49,28 +83,27 @@ enum filterType {
 };
 #define Q_BUTTERWORTH   0.707
 
+// the design of one section; its memory is kept by the BiquadBank that
+// runs it
 class BiquadDF1 {
 public:
     BiquadDF1() {}
     ~BiquadDF1() {}
     
-  void initStateVariables(){
-    x1=0.f;
-    x2=0.f;
-    y1=0.f;
-    y2=0.f;
-  }
-    
-  // function used for PEQ, HSH, LSH
+  // function used for PEQ, HSH, LSH; skipped while the inputs stay
+  // within knob noise of the last design
   void setCoeffs(float normalizedFrequency, float Q, float dbGain){        
-    float alpha, c, omega, d, e, gamma, beta ;        
+    if(cache.matches(normalizedFrequency, Q, dbGain))
+      return;
+    float alpha, c, s, omega, d, e, gamma, beta, g ;        
     omega = 2*M_PI*normalizedFrequency ;
-    c = cosf(omega) ;
-    alpha = sinf(omega)/(2*Q);
-    d = powf(10,dbGain/40.f);
-    gamma = alpha*powf(10,fabsf(dbGain)/40.f);
-    e = powf(10,fabsf(dbGain)/20.f);
-    beta = 2*alpha*powf(e,0.5f);        
+    fastSinCos(omega, &s, &c) ;
+    alpha = s/(2*Q);
+    g = fastPow10(fabsf(dbGain)/40.f); // d, gamma, e and beta all follow from 10^(|dB|/40)
+    d = dbGain < 0 ? 1/g : g;
+    gamma = alpha*g;
+    e = g*g;
+    beta = 2*alpha*g;        
     switch (fType)
       {
       case PEQ: // Parametric EQ
@@ -125,21 +158,13 @@ public:
       }        
   }
 
-  void copyCoeffs(BiquadDF1& other){
-    memcpy(a, other.a, sizeof(float)*3);
-    memcpy(b, other.b, sizeof(float)*3);
-  }
-
-  void process (int numSamples, float* buf){
-    float out;
-    for (int i=0;i<numSamples;i++){
-      out = b[0]*buf[i]+b[1]*x1+b[2]*x2-a[1]*y1-a[2]*y2 ;
-      y2 = y1;
-      y1 = out;
-      x2 = x1;
-      x1 = buf[i];
-      buf[i]=out;
-    }
+  // b0, b1, b2, a1, a2
+  void getCoeffs(float* coeffs){
+    coeffs[0] = b[0];
+    coeffs[1] = b[1];
+    coeffs[2] = b[2];
+    coeffs[3] = a[1];
+    coeffs[4] = a[2];
   }
     
   void setType (filterType typ){
@@ -149,29 +174,38 @@ public:
 private:
     float a[3] ; // ai coefficients
     float b[3] ; // bi coefficients
-    float x1, x2, y1, y2 ; // state variables to compute samples
     filterType fType;
+    CoeffsCache cache; // inputs of the current coefficients
 };
 
+// the four bands' designs, run on every channel from one BiquadBank
 class FourBandsEq {
 private:
     BiquadDF1 band1, band2, band3, band4; // filters
     float fn1, fn2, fn3, fn4; // cutoffs frequencies, normalized
+    BiquadBank<4, EQ_CHANNELS> bank; // their coefficients, and the memory of every channel
+#if EQ_LOOKAHEAD
+    BiquadLookahead<4, EQ_LOOKAHEAD> lookahead;
+#endif
+#if EQ_STATE_SPACE
+    BiquadStateSpace<4> stateSpace;
+    // it reads the bank's memory as the TDF2 s1, s2 of each band
+    static_assert(EQ_TOPOLOGY == TDF2, "EQ_STATE_SPACE needs EQ_TOPOLOGY TDF2");
+#endif
+#if EQ_FIXED_POINT
+    BiquadQ31Bank<4, EQ_CHANNELS> fixed; // the bands in Q31, and the memory of every channel
+#endif
 public:
-  FourBandsEq(double samplerate) {
-    band1.initStateVariables();
+  void init(double samplerate) {
     band1.setType(LSH);
     fn1=100/samplerate;
       
-    band2.initStateVariables();
     band2.setType(PEQ);
     fn2=250/samplerate;
       
-    band3.initStateVariables();
     band3.setType(PEQ);
     fn3=1500/samplerate;
       
-    band4.initStateVariables();
     band4.setType(PEQ);
     fn4=4000/samplerate;
   }
@@ -182,33 +216,79 @@ public:
     band2.setCoeffs(fn2, Q_BUTTERWORTH, b);
     band3.setCoeffs(fn3, Q_BUTTERWORTH, c);
     band4.setCoeffs(fn4, Q_BUTTERWORTH, d);
+    BiquadDF1* bands[4] = { &band1, &band2, &band3, &band4 };
+    float coeffs[5];
+    for(int k=0; k<4; k++){
+      bands[k]->getCoeffs(coeffs);
+      bank.setCoeffs(k, coeffs);
+#if EQ_FIXED_POINT
+      fixed.setCoeffs(k, coeffs);
+#endif
+    }
   }
 
-  void copyCoeffs(FourBandsEq& other){
-    band1.copyCoeffs(other.band1);
-    band2.copyCoeffs(other.band2);
-    band3.copyCoeffs(other.band3);
-    band4.copyCoeffs(other.band4);
+  void setTopology(biquadTopology topology){
+    bank.setTopology(topology);
   }
 
-  void process(int numSamples, float* buf){      
-    // process
-    band1.process(numSamples, buf);
-    band2.process(numSamples, buf);
-    band3.process(numSamples, buf);
-    band4.process(numSamples, buf);
+  // the memory of one channel, band after band
+#if EQ_FIXED_POINT
+  static const int STATE_SIZE = BiquadQ31Bank<4, EQ_CHANNELS>::STATE_SIZE;
+#else
+  static const int STATE_SIZE = BiquadBank<4, EQ_CHANNELS>::STATE_SIZE;
+#endif
+  void getStateVariables(int ch, float* state){
+#if EQ_FIXED_POINT
+    fixed.getStateVariables(ch, state);
+#else
+    bank.getStateVariables(ch, state);
+#endif
+  }
+  void setStateVariables(int ch, const float* state){
+#if EQ_FIXED_POINT
+    fixed.setStateVariables(ch, state);
+#else
+    bank.setStateVariables(ch, state);
+#endif
+  }
+
+  // channels 0 to channels-1 of buf, the four bands as one fused
+  // cascade, as many channels at a time as the lanes allow
+  void process(float* const* buf, int channels, int numSamples){
+    PROFILE_STAGE("FourBandsEq::process");
+#if EQ_FIXED_POINT
+    // in fixed point, see BiquadQ31.h
+    fixed.process(buf, channels, numSamples);
+#elif EQ_STATE_SPACE
+    // each channel as one 8th order state space, with TDF2 bands
+    for(int ch=0; ch<channels; ch++)
+      bank.processStateSpace(ch, stateSpace, buf[ch], numSamples);
+#else
+#if EQ_LOOKAHEAD
+    // the channel left over by the lane groups on its own, EQ_LOOKAHEAD
+    // samples at a time in DF1
+    if(channels%2 == 1 && bank.getTopology() == DF1){
+      channels--;
+      bank.processLookahead(channels, lookahead, buf[channels], numSamples);
+    }
+#endif
+    bank.process(buf, channels, numSamples);
+#endif
   }
 };
 
 /**
- * Stereo parametric EQ OWL Patch
+ * Parametric EQ OWL Patch, the same EQ on every channel of the buffer
+ * (up to EQ_CHANNELS)
  */
 class FourBandsEqPatch : public Patch {
 private:
-  FourBandsEq eqL;
-  FourBandsEq eqR;
+  FourBandsEq eq; // one set of coefficients, the memory of every channel
+  DenormalGuard denormals;
 public:
-  FourBandsEqPatch() : eqL(getSampleRate()), eqR(getSampleRate()) {
+  FourBandsEqPatch() {
+    eq.init(getSampleRate());
+    eq.setTopology(EQ_TOPOLOGY);
     registerParameter(PARAMETER_A, "Low", "Low");
     registerParameter(PARAMETER_B, "Lo-Mid", "Lo-Mid");
     registerParameter(PARAMETER_C, "Hi-Mid", "Hi-Mid");
@@ -220,15 +300,28 @@ public:
     float b = getDbGain(PARAMETER_B);
     float c = getDbGain(PARAMETER_C);
     float d = getDbGain(PARAMETER_D);
-    eqL.setCoeffs(a, b, c, d);
-    eqR.copyCoeffs(eqL);
+    int channels = min(buffer.getChannels(), EQ_CHANNELS);
+    eq.setCoeffs(a, b, c, d);
  
     // process
-    float numSamples = buffer.getSize();
-    float* bufL = buffer.getSamples(0);
-    float* bufR = buffer.getSamples(1);
-    eqL.process(numSamples, bufL);
-    eqR.process(numSamples, bufR);
+    int numSamples = buffer.getSize();
+    float* buf[EQ_CHANNELS];
+    for(int ch=0; ch<channels; ch++){
+      buf[ch] = buffer.getSamples(ch);
+      denormals.process(buf[ch], numSamples);
+    }
+    eq.process(buf, channels, numSamples);
+  }
+
+  // filter memory of all channels, for snapshot and restore
+  static const int STATE_SIZE = EQ_CHANNELS*FourBandsEq::STATE_SIZE;
+  void getStateVariables(float* state){
+    for(int ch=0; ch<EQ_CHANNELS; ch++)
+      eq.getStateVariables(ch, state+ch*FourBandsEq::STATE_SIZE);
+  }
+  void setStateVariables(const float* state){
+    for(int ch=0; ch<EQ_CHANNELS; ch++)
+      eq.setStateVariables(ch, state+ch*FourBandsEq::STATE_SIZE);
   }
     
 private:
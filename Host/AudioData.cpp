@@ -0,0 +1,215 @@
+#include "AudioData.h"
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+void AudioData::setChannels(int ch){
+  if(ch == channels || channels == 0)
+    return;
+  std::vector<float> remapped((size_t)ch*length);
+  for(int c=0; c<ch; c++)
+    memcpy(&remapped[(size_t)c*length], getChannel(c % channels), length*sizeof(float));
+  samples.swap(remapped);
+  channels = ch;
+}
+
+static uint32_t readLE(const uint8_t* p, int bytes){
+  uint32_t value = 0;
+  for(int i=0; i<bytes; i++)
+    value |= (uint32_t)p[i] << (8*i);
+  return value;
+}
+
+bool parseWavHeader(const uint8_t* bytes, size_t length, WavLayout& layout){
+  if(length < 12 || memcmp(bytes, "RIFF", 4) || memcmp(bytes+8, "WAVE", 4))
+    return false;
+  int format = 0, channels = 0, bits = 0;
+  uint32_t rate = 0;
+  size_t pos = 12;
+  while(pos+8 <= length){
+    const uint8_t* header = bytes+pos;
+    size_t size = readLE(header+4, 4);
+    const uint8_t* body = header+8;
+    if(pos+8+size > length)
+      size = length-pos-8;
+    if(memcmp(header, "fmt ", 4) == 0 && size >= 16){
+      format = readLE(body, 2);
+      channels = readLE(body+2, 2);
+      rate = readLE(body+4, 4);
+      bits = readLE(body+14, 2);
+      if(format == 0xfffe && size >= 26)
+	format = readLE(body+24, 2); // WAVE_FORMAT_EXTENSIBLE sub format
+    }else if(memcmp(header, "data", 4) == 0){
+      if(channels == 0 || (format != 1 && format != 3))
+	return false;
+      int width = bits/8;
+      if((format == 1 && (width < 2 || width > 4)) || (format == 3 && width != 4))
+	return false;
+      layout.isFloat = format == 3;
+      layout.channels = channels;
+      layout.bits = bits;
+      layout.width = width;
+      layout.sampleRate = rate;
+      layout.dataOffset = pos+8;
+      layout.frames = size/(width*channels);
+      return true;
+    }
+    pos += 8 + size + (size & 1);
+  }
+  return false;
+}
+
+bool readWavFile(const char* path, AudioData& data){
+  FILE* file = fopen(path, "rb");
+  if(file == NULL)
+    return false;
+  std::vector<uint8_t> bytes;
+  uint8_t chunk[4096];
+  size_t len;
+  while((len = fread(chunk, 1, sizeof(chunk), file)) > 0)
+    bytes.insert(bytes.end(), chunk, chunk+len);
+  fclose(file);
+  WavLayout layout;
+  if(bytes.empty() || !parseWavHeader(&bytes[0], bytes.size(), layout))
+    return false;
+  int channels = layout.channels;
+  int width = layout.width;
+  data.allocate(channels, layout.frames);
+  data.sampleRate = layout.sampleRate;
+  const uint8_t* body = &bytes[layout.dataOffset];
+  for(int i=0; i<data.length; i++){
+    for(int ch=0; ch<channels; ch++){
+      const uint8_t* p = body + ((size_t)i*channels+ch)*width;
+      float value;
+      if(layout.isFloat){
+	uint32_t raw = readLE(p, 4);
+	memcpy(&value, &raw, sizeof(value));
+      }else{
+	int32_t raw = readLE(p, width) << (32-layout.bits);
+	value = raw/2147483648.0f;
+      }
+      data.getChannel(ch)[i] = value;
+    }
+  }
+  return true;
+}
+
+static void putLE(uint8_t* p, uint32_t value, int bytes){
+  for(int i=0; i<bytes; i++)
+    p[i] = (value >> (8*i)) & 0xff;
+}
+
+void formatWavHeader(uint8_t* header, int channels, long frames, double sampleRate){
+  uint32_t dataSize = (uint32_t)frames*channels*4;
+  memcpy(header, "RIFF", 4);
+  putLE(header+4, 36+dataSize, 4);
+  memcpy(header+8, "WAVEfmt ", 8);
+  putLE(header+16, 16, 4);
+  putLE(header+20, 3, 2); // IEEE float
+  putLE(header+22, channels, 2);
+  putLE(header+24, (uint32_t)sampleRate, 4);
+  putLE(header+28, (uint32_t)sampleRate*channels*4, 4);
+  putLE(header+32, channels*4, 2);
+  putLE(header+34, 32, 2);
+  memcpy(header+36, "data", 4);
+  putLE(header+40, dataSize, 4);
+}
+
+bool writeWavFile(const char* path, AudioData& data){
+  FILE* file = fopen(path, "wb");
+  if(file == NULL)
+    return false;
+  uint8_t header[WAV_HEADER_SIZE];
+  formatWavHeader(header, data.channels, data.length, data.sampleRate);
+  fwrite(header, 1, sizeof(header), file);
+  for(int i=0; i<data.length; i++)
+    for(int ch=0; ch<data.channels; ch++)
+      fwrite(data.getChannel(ch)+i, sizeof(float), 1, file);
+  return fclose(file) == 0;
+}
+
+bool readRawFile(const char* path, AudioData& data){
+  FILE* file = fopen(path, "rb");
+  if(file == NULL || data.channels < 1)
+    return false;
+  std::vector<float> interleaved;
+  float chunk[1024];
+  size_t len;
+  while((len = fread(chunk, sizeof(float), 1024, file)) > 0)
+    interleaved.insert(interleaved.end(), chunk, chunk+len);
+  fclose(file);
+  int channels = data.channels;
+  data.allocate(channels, interleaved.size()/channels);
+  for(int i=0; i<data.length; i++)
+    for(int ch=0; ch<channels; ch++)
+      data.getChannel(ch)[i] = interleaved[(size_t)i*channels+ch];
+  return true;
+}
+
+static const char* signalNames[] = { "noise", "sine", "sweep", "impulse", "silence", "burst" };
+
+bool isSignalName(const char* name){
+  for(size_t i=0; i<sizeof(signalNames)/sizeof(signalNames[0]); i++)
+    if(strcmp(name, signalNames[i]) == 0)
+      return true;
+  return false;
+}
+
+void generateSignal(const char* name, AudioData& data, int channels, int length, double sampleRate){
+  data.allocate(channels, length);
+  data.sampleRate = sampleRate;
+  const float amplitude = 0.5f;
+  uint32_t seed = 0x4f574c21; // fixed so every run sees the same noise
+  for(int ch=0; ch<channels; ch++){
+    float* out = data.getChannel(ch);
+    if(strcmp(name, "noise") == 0 || strcmp(name, "burst") == 0){
+      // a burst is noise followed by digital silence, so that recursive
+      // filter states decay towards subnormal values
+      int end = strcmp(name, "burst") == 0 ? length/8 : length;
+      for(int i=0; i<end; i++){
+	seed = seed*1664525u + 1013904223u;
+	out[i] = amplitude*((int32_t)seed/2147483648.0f);
+      }
+    }else if(strcmp(name, "sine") == 0){
+      for(int i=0; i<length; i++)
+	out[i] = amplitude*sin(2*M_PI*440.0*i/sampleRate);
+    }else if(strcmp(name, "sweep") == 0){
+      // exponential 20 Hz to 20 kHz over the whole signal
+      double f1 = 20.0, f2 = fmin(20000.0, sampleRate*0.45);
+      double duration = length/sampleRate;
+      double k = log(f2/f1);
+      for(int i=0; i<length; i++){
+	double t = i/sampleRate;
+	out[i] = amplitude*sin(2*M_PI*f1*duration/k*(exp(t*k/duration)-1));
+      }
+    }else if(strcmp(name, "impulse") == 0){
+      if(length > 0)
+	out[0] = 1.0f;
+    }
+  }
+}
+
+bool loadInput(const char* spec, AudioData& data, int channels, int length, double sampleRate){
+  if(isSignalName(spec)){
+    generateSignal(spec, data, channels, length, sampleRate);
+    return true;
+  }
+  size_t len = strlen(spec);
+  bool ok;
+  if(len > 4 && strcasecmp(spec+len-4, ".wav") == 0){
+    ok = readWavFile(spec, data);
+  }else{
+    data.channels = channels;
+    data.sampleRate = sampleRate;
+    ok = readRawFile(spec, data);
+  }
+  if(ok)
+    data.setChannels(channels);
+  return ok;
+}
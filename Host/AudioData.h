@@ -0,0 +1,68 @@
+/*
+ Non-interleaved audio held in memory, plus the sources the host tools
+ can fill it from: WAV files, raw float32 files and synthetic signals.
+*/
+
+#ifndef __AudioData_h__
+#define __AudioData_h__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+class AudioData {
+public:
+  int channels;
+  int length;
+  double sampleRate;
+  std::vector<float> samples; // channel ch starts at ch*length
+
+  AudioData() : channels(0), length(0), sampleRate(48000) {}
+
+  void allocate(int ch, int len){
+    channels = ch;
+    length = len;
+    samples.assign((size_t)ch*len, 0.0f);
+  }
+
+  float* getChannel(int ch){
+    return &samples[(size_t)ch*length];
+  }
+
+  // remap to a different channel count, duplicating or dropping channels
+  void setChannels(int ch);
+};
+
+// where the samples of a WAV file are and how they are stored
+struct WavLayout {
+  bool isFloat;      // 32 bit IEEE float, otherwise integer PCM
+  int channels;
+  int bits;
+  int width;         // bytes per sample
+  double sampleRate;
+  size_t dataOffset; // of the first sample from the start of the file
+  long frames;
+};
+
+// 16, 24 or 32 bit PCM and 32 bit float WAV
+bool parseWavHeader(const uint8_t* bytes, size_t length, WavLayout& layout);
+bool readWavFile(const char* path, AudioData& data);
+// written as 32 bit float
+bool writeWavFile(const char* path, AudioData& data);
+
+#define WAV_HEADER_SIZE 44
+// the header of a float WAV file holding 'frames' frames
+void formatWavHeader(uint8_t* header, int channels, long frames, double sampleRate);
+
+// headerless interleaved float32; data.channels and data.sampleRate must be set
+bool readRawFile(const char* path, AudioData& data);
+
+// true if 'name' is one of: noise, sine, sweep, impulse, silence, burst
+bool isSignalName(const char* name);
+// deterministic test signals, 0.5 peak, seeded so that runs are repeatable
+void generateSignal(const char* name, AudioData& data, int channels, int length, double sampleRate);
+
+// synthetic signal name, .wav file or raw float32 file
+bool loadInput(const char* spec, AudioData& data, int channels, int length, double sampleRate);
+
+#endif // __AudioData_h__
@@ -0,0 +1,65 @@
+#include "Benchmark.h"
+#include "HostClock.h"
+#include "SampleBuffer.h"
+#include "ProfileStage.h"
+#include "CoeffsCacheStats.h"
+
+BenchmarkResult runBenchmark(PatchProcessor& processor, AudioData& input,
+			     int warmup, AudioData* output,
+			     const ParameterSchedule* schedule,
+			     std::vector<uint64_t>* blockNs){
+  int blockSize = processor.getBlockSize();
+  SampleBuffer buffer(input.channels, blockSize);
+  std::vector<float*> in(input.channels);
+  std::vector<float*> out(input.channels);
+  if(output){
+    output->allocate(input.channels, input.length);
+    output->sampleRate = input.sampleRate;
+  }
+  for(int ch=0; ch<input.channels; ch++){
+    in[ch] = input.getChannel(ch);
+    out[ch] = output ? output->getChannel(ch) : NULL;
+  }
+  BenchmarkResult result = { 0, 0, 0, UINT64_MAX, 0, -1 };
+  if(blockNs){
+    blockNs->clear();
+    blockNs->reserve((input.length+blockSize-1)/blockSize);
+  }
+  int block = 0;
+  for(int pos=0; pos<input.length; pos += blockSize, block++){
+#ifdef BLOCK_LOAD_MONITOR
+    if(block == warmup)
+      processor.getLoadMonitor().reset();
+#endif
+#ifdef PROFILE_STAGES
+    if(block == warmup)
+      StageProfiler::reset();
+#endif
+    if(block == warmup)
+      CoeffsCacheStats::reset();
+    int length = min(blockSize, input.length-pos);
+    buffer.load(&in[0], pos, length);
+    if(schedule)
+      schedule->apply(processor, block);
+    uint64_t start = getNanoseconds();
+    processor.process(buffer);
+    uint64_t elapsed = getNanoseconds()-start;
+    if(output)
+      buffer.store(&out[0], pos, length);
+    if(blockNs)
+      blockNs->push_back(elapsed);
+    if(block < warmup)
+      continue;
+    result.blocks++;
+    result.frames += blockSize;
+    result.totalNs += elapsed;
+    result.bestNs = min(result.bestNs, elapsed);
+    if(elapsed > result.worstNs){
+      result.worstNs = elapsed;
+      result.worstBlock = block;
+    }
+  }
+  if(result.blocks == 0)
+    result.bestNs = 0;
+  return result;
+}
@@ -0,0 +1,45 @@
+/*
+ Drives a loaded patch block by block over an input signal and times each
+ call to processAudio.
+*/
+
+#ifndef __Benchmark_h__
+#define __Benchmark_h__
+
+#include <stdint.h>
+#include "AudioData.h"
+#include "PatchProcessor.h"
+#include "ParameterSchedule.h"
+
+struct BenchmarkResult {
+  int blocks;         // timed blocks
+  long frames;        // timed sample frames
+  uint64_t totalNs;
+  uint64_t bestNs;
+  uint64_t worstNs;
+  int worstBlock;     // index into the input, in blocks, of the slowest call
+
+  // processing time per sample frame (all channels of one sample period)
+  double getNsPerSample() const {
+    return frames ? (double)totalNs/frames : 0;
+  }
+  // seconds of audio processed per second of CPU time
+  double getRealtimeFactor(double sampleRate) const {
+    return totalNs ? (frames/sampleRate)/(totalNs*1e-9) : 0;
+  }
+  // time available for one block at the given rate
+  static double getBudgetNs(int blockSize, double sampleRate){
+    return blockSize*1e9/sampleRate;
+  }
+};
+
+// The first 'warmup' blocks are processed but not timed. If 'output' is
+// given it receives the processed signal, same layout as the input. A
+// schedule sets the parameters before each block, and 'blockNs' receives
+// the time of every block, warm-up included.
+BenchmarkResult runBenchmark(PatchProcessor& processor, AudioData& input,
+			     int warmup, AudioData* output = NULL,
+			     const ParameterSchedule* schedule = NULL,
+			     std::vector<uint64_t>* blockNs = NULL);
+
+#endif // __Benchmark_h__
@@ -0,0 +1,71 @@
+#include "BlockLoadMonitor.h"
+#include <math.h>
+#include <string.h>
+
+BlockLoadMonitor::BlockLoadMonitor() : start(0), budget(1) {
+  reset();
+}
+
+void BlockLoadMonitor::setBudget(int blockSize, double sampleRate){
+  budget = blockSize*getCycleFrequency()/sampleRate;
+}
+
+void BlockLoadMonitor::reset(){
+  memset(histogram, 0, sizeof(histogram));
+  blocks = 0;
+  overruns = 0;
+  minCycles = UINT64_MAX;
+  maxCycles = 0;
+  totalCycles = 0;
+}
+
+void BlockLoadMonitor::record(uint64_t cycles){
+  blocks++;
+  totalCycles += cycles;
+  if(cycles < minCycles)
+    minCycles = cycles;
+  if(cycles > maxCycles)
+    maxCycles = cycles;
+  if(cycles > budget)
+    overruns++;
+  int bin = 0;
+  if(cycles > 0)
+    bin = (int)floor((log2(cycles/budget)-MIN_OCTAVE)*BINS_PER_OCTAVE);
+  histogram[bin < 0 ? 0 : bin < BINS ? bin : BINS-1]++;
+}
+
+double BlockLoadMonitor::getMinLoad() const {
+  return blocks ? minCycles/budget : 0;
+}
+
+double BlockLoadMonitor::getMeanLoad() const {
+  return blocks ? totalCycles/blocks/budget : 0;
+}
+
+double BlockLoadMonitor::getMaxLoad() const {
+  return maxCycles/budget;
+}
+
+double BlockLoadMonitor::getPercentileLoad(double percentile) const {
+  if(blocks == 0)
+    return 0;
+  long target = (long)(blocks*percentile/100.0);
+  long count = 0;
+  for(int i=0; i<BINS; i++){
+    count += histogram[i];
+    if(count > target) // upper edge of the bin, but never above the true maximum
+      return fmin(getMaxLoad(), exp2((double)(i+1)/BINS_PER_OCTAVE+MIN_OCTAVE));
+  }
+  return getMaxLoad();
+}
+
+void BlockLoadMonitor::printHeader(FILE* out){
+  fprintf(out, "%-32s %8s %8s %8s %8s %8s %10s\n",
+	  "patch", "blocks", "min %", "mean %", "p99 %", "max %", "overruns");
+}
+
+void BlockLoadMonitor::print(FILE* out, const char* name) const {
+  fprintf(out, "%-32s %8ld %8.2f %8.2f %8.2f %8.2f %10ld\n", name, blocks,
+	  100*getMinLoad(), 100*getMeanLoad(), 100*getPercentileLoad(99),
+	  100*getMaxLoad(), overruns);
+}
@@ -0,0 +1,77 @@
+/*
+ Per-block CPU load of processAudio against the block deadline
+ (getBlockSize()/getSampleRate()), measured in cycle counter ticks.
+
+ Opt-in: build with -DBLOCK_LOAD_MONITOR (make BLOCK_LOAD=1). Without it
+ the LOAD_MONITOR_* macros expand to nothing and PatchProcessor carries no
+ monitor, so the timed path is exactly the plain processAudio call.
+
+ Recording never allocates: loads are binned into a fixed histogram from
+ which the percentiles are read.
+*/
+
+#ifndef __BlockLoadMonitor_h__
+#define __BlockLoadMonitor_h__
+
+#include <stdint.h>
+#include <stdio.h>
+#include "HostClock.h"
+
+class BlockLoadMonitor {
+public:
+  BlockLoadMonitor();
+  // deadline for one block; call before the first block
+  void setBudget(int blockSize, double sampleRate);
+  void reset();
+
+  void begin(){
+    start = readCycleCounter();
+  }
+  void end(){
+    record(readCycleCounter()-start);
+  }
+  void record(uint64_t cycles);
+
+  long getBlocks() const {
+    return blocks;
+  }
+  long getOverruns() const {
+    return overruns;
+  }
+  double getBudgetCycles() const {
+    return budget;
+  }
+  // loads are fractions of the budget: 1.0 means the block just made it
+  double getMinLoad() const;
+  double getMeanLoad() const;
+  double getMaxLoad() const;
+  double getPercentileLoad(double percentile) const;
+
+  static void printHeader(FILE* out);
+  void print(FILE* out, const char* name) const;
+
+private:
+  // logarithmic bins, 16 per octave of load from 2^-16 up to 2^4 (1600%),
+  // so percentiles keep ~4% relative precision at any load level
+  static const int BINS_PER_OCTAVE = 16;
+  static const int MIN_OCTAVE = -16;
+  static const int BINS = 20*BINS_PER_OCTAVE;
+  uint32_t histogram[BINS];
+  uint64_t start;
+  double budget;
+  long blocks;
+  long overruns;
+  uint64_t minCycles;
+  uint64_t maxCycles;
+  double totalCycles;
+};
+
+#ifdef BLOCK_LOAD_MONITOR
+#define LOAD_MONITOR_BEGIN(monitor) (monitor).begin()
+#define LOAD_MONITOR_END(monitor) (monitor).end()
+#else
+#define LOAD_MONITOR_BEGIN(monitor)
+#define LOAD_MONITOR_END(monitor)
+#endif
+
+#endif // __BlockLoadMonitor_h__
@@ -0,0 +1,29 @@
+#include "CoeffsCacheStats.h"
+#include <atomic>
+
+static std::atomic<uint64_t> lookups(0);
+static std::atomic<uint64_t> hits(0);
+
+void CoeffsCacheStats::count(bool hit){
+  lookups.fetch_add(1, std::memory_order_relaxed);
+  if(hit)
+    hits.fetch_add(1, std::memory_order_relaxed);
+}
+
+void CoeffsCacheStats::reset(){
+  lookups.store(0, std::memory_order_relaxed);
+  hits.store(0, std::memory_order_relaxed);
+}
+
+uint64_t CoeffsCacheStats::getLookups(){
+  return lookups.load(std::memory_order_relaxed);
+}
+
+uint64_t CoeffsCacheStats::getHits(){
+  return hits.load(std::memory_order_relaxed);
+}
+
+double CoeffsCacheStats::getHitRate(){
+  uint64_t n = getLookups();
+  return n ? 100.0*getHits()/n : -1;
+}
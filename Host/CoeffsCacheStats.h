@@ -0,0 +1,27 @@
+/*
+ Hit and miss counts of the EQ filters' coefficient caches (../CoeffsCache.h),
+ summed over every filter of every patch instance since the last reset.
+
+ Counted with relaxed atomics, so the threaded tools may run while
+ counting; the figures are only meaningful with one patch at a time.
+ Every lookup then touches the same shared counters, which costs the
+ threaded tools cross-core traffic, so the counting is only built in
+ with COEFFS_CACHE=1 (see Makefile).
+*/
+
+#ifndef __CoeffsCacheStats_h__
+#define __CoeffsCacheStats_h__
+
+#include <stdint.h>
+
+class CoeffsCacheStats {
+public:
+  static void count(bool hit);
+  static void reset();
+  static uint64_t getLookups();
+  static uint64_t getHits();
+  // percentage of designs skipped, or -1 if no filter looked up its cache
+  static double getHitRate();
+};
+
+#endif // __CoeffsCacheStats_h__
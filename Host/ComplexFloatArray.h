@@ -0,0 +1,64 @@
+/*
+ Host stand-in for the OWL ComplexFloatArray: interleaved re/im pairs.
+*/
+
+#ifndef __ComplexFloatArray_h__
+#define __ComplexFloatArray_h__
+
+#include "basicmaths.h"
+
+struct ComplexFloat {
+  float re;
+  float im;
+
+  float getMagnitude() const {
+    return sqrtf(re*re + im*im);
+  }
+
+  float getPhase() const {
+    return atan2f(im, re);
+  }
+};
+
+class ComplexFloatArray {
+private:
+  ComplexFloat* data;
+  int size;
+public:
+  ComplexFloatArray() : data(NULL), size(0) {}
+  ComplexFloatArray(ComplexFloat* d, int s) : data(d), size(s) {}
+
+  int getSize() const {
+    return size;
+  }
+
+  ComplexFloat* getData() {
+    return data;
+  }
+
+  ComplexFloat& operator[](const int index) {
+    return data[index];
+  }
+
+  operator ComplexFloat*() {
+    return data;
+  }
+
+  void clear() {
+    memset(data, 0, size*sizeof(ComplexFloat));
+  }
+
+  void copyFrom(ComplexFloatArray other) {
+    memcpy(data, other.data, min(size, other.size)*sizeof(ComplexFloat));
+  }
+
+  static ComplexFloatArray create(int size) {
+    return ComplexFloatArray(new ComplexFloat[size](), size);
+  }
+
+  static void destroy(ComplexFloatArray array) {
+    delete[] array.data;
+  }
+};
+
+#endif // __ComplexFloatArray_h__
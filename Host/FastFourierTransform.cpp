@@ -0,0 +1,94 @@
+#include "FastFourierTransform.h"
+#include "ProfileStage.h"
+
+FastFourierTransform::FastFourierTransform() : size(0), bitReverse(NULL) {}
+
+FastFourierTransform::~FastFourierTransform(){
+  ComplexFloatArray::destroy(twiddles);
+  delete[] bitReverse;
+}
+
+void FastFourierTransform::init(int len){
+  ComplexFloatArray::destroy(twiddles);
+  delete[] bitReverse;
+  size = len;
+  twiddles = ComplexFloatArray::create(len/2);
+  for(int i=0; i<len/2; i++){
+    twiddles[i].re = cos(2*M_PI*i/len);
+    twiddles[i].im = -sin(2*M_PI*i/len);
+  }
+  int bits = 0;
+  while((1<<bits) < len)
+    bits++;
+  bitReverse = new int[len];
+  for(int i=0; i<len; i++){
+    int r = 0;
+    for(int b=0; b<bits; b++)
+      if(i & (1<<b))
+	r |= 1<<(bits-1-b);
+    bitReverse[i] = r;
+  }
+}
+
+void FastFourierTransform::transform(ComplexFloatArray data, bool inverse){
+  for(int i=0; i<size; i++){
+    int j = bitReverse[i];
+    if(j > i){
+      ComplexFloat tmp = data[i];
+      data[i] = data[j];
+      data[j] = tmp;
+    }
+  }
+  for(int span=1; span<size; span <<= 1){
+    int step = size/(2*span);
+    for(int start=0; start<size; start += 2*span){
+      for(int k=0; k<span; k++){
+	ComplexFloat w = twiddles[k*step];
+	if(inverse)
+	  w.im = -w.im;
+	ComplexFloat& u = data[start+k];
+	ComplexFloat& v = data[start+k+span];
+	float tre = v.re*w.re - v.im*w.im;
+	float tim = v.re*w.im + v.im*w.re;
+	v.re = u.re - tre;
+	v.im = u.im - tim;
+	u.re += tre;
+	u.im += tim;
+      }
+    }
+  }
+}
+
+void FastFourierTransform::fft(FloatArray input, ComplexFloatArray output){
+  PROFILE_STAGE("FastFourierTransform::fft");
+  for(int i=0; i<size; i++){
+    output[i].re = input[i];
+    output[i].im = 0;
+  }
+  transform(output, false);
+}
+
+void FastFourierTransform::fft(ComplexFloatArray input, ComplexFloatArray output){
+  PROFILE_STAGE("FastFourierTransform::fft");
+  output.copyFrom(input);
+  transform(output, false);
+}
+
+void FastFourierTransform::ifft(ComplexFloatArray input, FloatArray output){
+  PROFILE_STAGE("FastFourierTransform::ifft");
+  transform(input, true);
+  float scale = 1.0f/size;
+  for(int i=0; i<size; i++)
+    output[i] = input[i].re*scale;
+}
+
+void FastFourierTransform::ifft(ComplexFloatArray input, ComplexFloatArray output){
+  PROFILE_STAGE("FastFourierTransform::ifft");
+  output.copyFrom(input);
+  transform(output, true);
+  float scale = 1.0f/size;
+  for(int i=0; i<size; i++){
+    output[i].re *= scale;
+    output[i].im *= scale;
+  }
+}
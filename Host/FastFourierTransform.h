@@ -0,0 +1,34 @@
+/*
+ Host stand-in for the OWL FastFourierTransform (arm_cfft_f32 on the pedal).
+ Radix-2 complex transform; sizes must be a power of two. All tables are
+ allocated in init() so fft() and ifft() never touch the heap.
+*/
+
+#ifndef __FastFourierTransform_h__
+#define __FastFourierTransform_h__
+
+#include "FloatArray.h"
+#include "ComplexFloatArray.h"
+
+class FastFourierTransform {
+private:
+  int size;
+  ComplexFloatArray twiddles;
+  int* bitReverse;
+  void transform(ComplexFloatArray data, bool inverse);
+public:
+  FastFourierTransform();
+  ~FastFourierTransform();
+  void init(int len);
+  // real input, complex output (imaginary parts of the input are zero)
+  void fft(FloatArray input, ComplexFloatArray output);
+  void fft(ComplexFloatArray input, ComplexFloatArray output);
+  // scales by 1/N like arm_cfft_f32; the input array is used as scratch
+  void ifft(ComplexFloatArray input, FloatArray output);
+  void ifft(ComplexFloatArray input, ComplexFloatArray output);
+  int getSize() const {
+    return size;
+  }
+};
+
+#endif // __FastFourierTransform_h__
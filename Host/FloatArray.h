@@ -0,0 +1,51 @@
+/*
+ Host stand-in for the OWL FloatArray: a non-owning view on a float buffer.
+*/
+
+#ifndef __FloatArray_h__
+#define __FloatArray_h__
+
+#include "basicmaths.h"
+
+class FloatArray {
+private:
+  float* data;
+  int size;
+public:
+  FloatArray() : data(NULL), size(0) {}
+  FloatArray(float* d, int s) : data(d), size(s) {}
+
+  int getSize() const {
+    return size;
+  }
+
+  float* getData() {
+    return data;
+  }
+
+  float& operator[](const int index) {
+    return data[index];
+  }
+
+  operator float*() {
+    return data;
+  }
+
+  void clear() {
+    memset(data, 0, size*sizeof(float));
+  }
+
+  void copyFrom(const float* other, int length) {
+    memcpy(data, other, min(size, length)*sizeof(float));
+  }
+
+  static FloatArray create(int size) {
+    return FloatArray(new float[size](), size);
+  }
+
+  static void destroy(FloatArray array) {
+    delete[] array.data;
+  }
+};
+
+#endif // __FloatArray_h__
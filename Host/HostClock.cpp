@@ -0,0 +1,23 @@
+#include "HostClock.h"
+
+static double measureCycleFrequency(){
+#if defined(__aarch64__)
+  uint64_t freq;
+  asm volatile("mrs %0, cntfrq_el0" : "=r"(freq));
+  return freq;
+#elif defined(__x86_64__) || defined(__i386__)
+  uint64_t ns0 = getNanoseconds();
+  uint64_t c0 = readCycleCounter();
+  while(getNanoseconds()-ns0 < 20000000ull);
+  uint64_t ns1 = getNanoseconds();
+  uint64_t c1 = readCycleCounter();
+  return (c1-c0)*1e9/(ns1-ns0);
+#else
+  return 1e9;
+#endif
+}
+
+double getCycleFrequency(){
+  static double frequency = measureCycleFrequency();
+  return frequency;
+}
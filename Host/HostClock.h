@@ -0,0 +1,36 @@
+/*
+ Monotonic wall-clock timestamps and raw CPU cycle counts for the host tools.
+*/
+
+#ifndef __HostClock_h__
+#define __HostClock_h__
+
+#include <stdint.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+inline uint64_t getNanoseconds(){
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec*1000000000ull + ts.tv_nsec;
+}
+
+// time stamp counter on x86, virtual counter on aarch64, else nanoseconds
+inline uint64_t readCycleCounter(){
+#if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#elif defined(__aarch64__)
+  uint64_t count;
+  asm volatile("mrs %0, cntvct_el0" : "=r"(count));
+  return count;
+#else
+  return getNanoseconds();
+#endif
+}
+
+// ticks of readCycleCounter() per second, measured once on first use
+double getCycleFrequency();
+
+#endif // __HostClock_h__
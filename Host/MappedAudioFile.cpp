@@ -0,0 +1,144 @@
+#include "MappedAudioFile.h"
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+bool MappedAudioFile::openRead(const char* path, int rawChannels, double rawRate){
+  close();
+  fd = open(path, O_RDONLY);
+  if(fd < 0)
+    return false;
+  struct stat info;
+  if(fstat(fd, &info) != 0 || info.st_size == 0){
+    close();
+    return false;
+  }
+  mapSize = info.st_size;
+  map = (uint8_t*)mmap(NULL, mapSize, PROT_READ, MAP_PRIVATE, fd, 0);
+  if(map == MAP_FAILED){
+    map = NULL;
+    close();
+    return false;
+  }
+  madvise(map, mapSize, MADV_SEQUENTIAL);
+  if(parseWavHeader(map, mapSize, layout))
+    return true;
+  if(rawChannels < 1){
+    close();
+    return false;
+  }
+  layout.isFloat = true;
+  layout.channels = rawChannels;
+  layout.bits = 32;
+  layout.width = 4;
+  layout.sampleRate = rawRate;
+  layout.dataOffset = 0;
+  layout.frames = mapSize/(4*rawChannels);
+  return true;
+}
+
+bool MappedAudioFile::openWrite(const char* path, int channels, long frames, double sampleRate){
+  close();
+  fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0666);
+  if(fd < 0)
+    return false;
+  mapSize = WAV_HEADER_SIZE + (size_t)frames*channels*4;
+  if(ftruncate(fd, mapSize) != 0){
+    close();
+    return false;
+  }
+  map = (uint8_t*)mmap(NULL, mapSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if(map == MAP_FAILED){
+    map = NULL;
+    close();
+    return false;
+  }
+  formatWavHeader(map, channels, frames, sampleRate);
+  layout.isFloat = true;
+  layout.channels = channels;
+  layout.bits = 32;
+  layout.width = 4;
+  layout.sampleRate = sampleRate;
+  layout.dataOffset = WAV_HEADER_SIZE;
+  layout.frames = frames;
+  return true;
+}
+
+bool MappedAudioFile::openUpdate(const char* path){
+  close();
+  fd = open(path, O_RDWR);
+  if(fd < 0)
+    return false;
+  struct stat info;
+  if(fstat(fd, &info) != 0 || info.st_size == 0){
+    close();
+    return false;
+  }
+  mapSize = info.st_size;
+  map = (uint8_t*)mmap(NULL, mapSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if(map == MAP_FAILED){
+    map = NULL;
+    close();
+    return false;
+  }
+  if(!parseWavHeader(map, mapSize, layout) || !layout.isFloat || layout.width != 4){
+    close();
+    return false;
+  }
+  return true;
+}
+
+void MappedAudioFile::close(){
+  if(map)
+    munmap(map, mapSize);
+  if(fd >= 0)
+    ::close(fd);
+  map = NULL;
+  mapSize = 0;
+  fd = -1;
+}
+
+void MappedAudioFile::read(AudioBuffer& buffer, long offset){
+  int size = buffer.getSize();
+  int length = offset < layout.frames ? min((long)size, layout.frames-offset) : 0;
+  int channels = layout.channels;
+  int width = layout.width;
+  const uint8_t* frame = map + layout.dataOffset + (size_t)offset*channels*width;
+  for(int ch=0; ch<buffer.getChannels(); ch++){
+    float* dest = buffer.getSamples(ch);
+    const uint8_t* p = frame + (ch % channels)*width;
+    size_t stride = (size_t)channels*width;
+    if(layout.isFloat){
+      for(int i=0; i<length; i++, p += stride)
+	memcpy(dest+i, p, sizeof(float));
+    }else if(width == 2){
+      for(int i=0; i<length; i++, p += stride){
+	int16_t value;
+	memcpy(&value, p, sizeof(value));
+	dest[i] = value*(1.0f/32768.0f);
+      }
+    }else{
+      // 24 and 32 bit PCM, left aligned into an int32
+      for(int i=0; i<length; i++, p += stride){
+	uint32_t raw = 0;
+	for(int b=0; b<width; b++)
+	  raw |= (uint32_t)p[b] << (8*(b+4-width));
+	dest[i] = (int32_t)raw*(1.0f/2147483648.0f);
+      }
+    }
+    memset(dest+length, 0, (size-length)*sizeof(float));
+  }
+}
+
+void MappedAudioFile::write(AudioBuffer& buffer, long offset, int frames){
+  int channels = layout.channels;
+  frames = min((long)frames, layout.frames-offset);
+  uint8_t* frame = map + layout.dataOffset + (size_t)offset*channels*4;
+  for(int ch=0; ch<channels; ch++){
+    float* src = buffer.getSamples(ch);
+    uint8_t* p = frame + ch*4;
+    for(int i=0; i<frames; i++, p += channels*4)
+      memcpy(p, src+i, sizeof(float));
+  }
+}
@@ -0,0 +1,51 @@
+/*
+ An audio file mapped into memory for streaming. Blocks are converted
+ straight between the mapping and an AudioBuffer, so a file is never
+ copied whole and files larger than memory stream through the page cache.
+*/
+
+#ifndef __MappedAudioFile_h__
+#define __MappedAudioFile_h__
+
+#include "StompBox.h"
+#include "AudioData.h"
+
+class MappedAudioFile {
+private:
+  int fd;
+  uint8_t* map;
+  size_t mapSize;
+  WavLayout layout;
+public:
+  MappedAudioFile() : fd(-1), map(NULL), mapSize(0) {}
+  ~MappedAudioFile(){
+    close();
+  }
+  // a WAV file by its header, anything else as raw interleaved float32
+  // with the given channels and rate
+  bool openRead(const char* path, int rawChannels, double rawRate);
+  // a float WAV file of the given shape, sized up front
+  bool openWrite(const char* path, int channels, long frames, double sampleRate);
+  // an existing float WAV file, for writing parts of it in place
+  bool openUpdate(const char* path);
+  void close();
+
+  int getChannels() const {
+    return layout.channels;
+  }
+  long getFrames() const {
+    return layout.frames;
+  }
+  double getSampleRate() const {
+    return layout.sampleRate;
+  }
+
+  // the block of frames starting at 'offset' into every channel of the
+  // buffer, zero padded past the end; buffer channels beyond the file's
+  // repeat its channels
+  void read(AudioBuffer& buffer, long offset);
+  // the first 'frames' frames of the buffer's first getChannels() channels
+  void write(AudioBuffer& buffer, long offset, int frames);
+};
+
+#endif // __MappedAudioFile_h__
@@ -0,0 +1,110 @@
+#include "ParameterSchedule.h"
+#include "PatchProcessor.h"
+
+static const char* trajectoryNames[] = { "static", "sweep", "jumps", "random", "jitter", NULL };
+
+// thresholds the patches compare knob values against
+static const float boundaries[] = { 0.025f, 0.25f, 0.5f, 0.75f, 0.975f };
+
+static uint32_t nextRandom(uint32_t& state){
+  state ^= state << 13;
+  state ^= state >> 17;
+  state ^= state << 5;
+  return state;
+}
+
+static float uniform(uint32_t& state){
+  return (nextRandom(state) >> 8)*(1.0f/16777216.0f);
+}
+
+bool ParameterSchedule::isTrajectoryName(const char* name){
+  for(int i=0; trajectoryNames[i]; i++)
+    if(strcmp(name, trajectoryNames[i]) == 0)
+      return true;
+  return false;
+}
+
+const char* ParameterSchedule::getTrajectoryName(int index){
+  if(index < 0 || index >= (int)(sizeof(trajectoryNames)/sizeof(trajectoryNames[0])))
+    return NULL;
+  return trajectoryNames[index];
+}
+
+void ParameterSchedule::resize(int count){
+  blocks = count;
+  values.resize((size_t)count*NOF_PARAMETERS, 0.5f);
+}
+
+void ParameterSchedule::setValue(int block, PatchParameterId pid, float value){
+  values[(size_t)block*NOF_PARAMETERS+pid] = max(0.0f, min(1.0f, value));
+}
+
+void ParameterSchedule::generate(const char* trajectory, uint32_t seed, int count){
+  resize(count);
+  uint32_t state = seed ? seed : 1;
+  float base[NOF_PARAMETERS];
+  float phase[NOF_PARAMETERS];
+  int boundary[NOF_PARAMETERS];
+  int nofBoundaries = sizeof(boundaries)/sizeof(boundaries[0]);
+  for(int p=0; p<NOF_PARAMETERS; p++){
+    base[p] = uniform(state);
+    phase[p] = uniform(state);
+    boundary[p] = nextRandom(state) % nofBoundaries;
+  }
+  for(int b=0; b<count; b++){
+    for(int p=0; p<NOF_PARAMETERS; p++){
+      PatchParameterId pid = (PatchParameterId)p;
+      float value;
+      if(strcmp(trajectory, "sweep") == 0){
+	float t = fmodf((float)b/count + phase[p], 1.0f);
+	value = t < 0.5f ? 2*t : 2-2*t;
+      }else if(strcmp(trajectory, "jumps") == 0){
+	value = ((b+p) & 1) ? 1.0f : 0.0f;
+      }else if(strcmp(trajectory, "random") == 0){
+	value = uniform(state);
+      }else if(strcmp(trajectory, "jitter") == 0){
+	// move to another threshold now and then, jitter around it otherwise
+	if(nextRandom(state) % 64 == 0)
+	  boundary[p] = nextRandom(state) % nofBoundaries;
+	value = boundaries[boundary[p]] + 0.06f*(uniform(state)-0.5f);
+      }else{
+	value = base[p];
+      }
+      setValue(b, pid, value);
+    }
+  }
+}
+
+void ParameterSchedule::apply(PatchProcessor& processor, int block) const {
+  if(block >= blocks)
+    block = blocks-1;
+  if(block < 0)
+    return;
+  for(int p=0; p<NOF_PARAMETERS; p++)
+    processor.setParameterValue((PatchParameterId)p, getValue(block, (PatchParameterId)p));
+}
+
+void ParameterSchedule::write(FILE* out, int lastBlock) const {
+  for(int b=0; b<=lastBlock && b<blocks; b++){
+    for(int p=0; p<NOF_PARAMETERS; p++)
+      fprintf(out, p ? " %.9g" : "%.9g", getValue(b, (PatchParameterId)p));
+    fprintf(out, "\n");
+  }
+}
+
+bool ParameterSchedule::read(FILE* in){
+  blocks = 0;
+  values.clear();
+  float row[NOF_PARAMETERS];
+  for(;;){
+    int p = 0;
+    while(p < NOF_PARAMETERS && fscanf(in, "%f", &row[p]) == 1)
+      p++;
+    if(p == 0)
+      return blocks > 0;
+    if(p != NOF_PARAMETERS)
+      return false;
+    values.insert(values.end(), row, row+NOF_PARAMETERS);
+    blocks++;
+  }
+}
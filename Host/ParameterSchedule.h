@@ -0,0 +1,54 @@
+/*
+ Parameter values for every block of a run, generated from a named
+ trajectory and a seed so that any run can be reproduced exactly.
+
+ Trajectories:
+   static   one random setting held for the whole run
+   sweep    every parameter ramps 0 -> 1 -> 0, each with its own phase
+   jumps    full-range jumps between 0 and 1, staggered per parameter
+   random   independent uniform values every block
+   jitter   knob noise of +/-0.03 around the thresholds the patches switch
+            on (quarter points, where chooseModel's 0.02 hysteresis sits,
+            and the 0.025 / 0.975 speed cut-offs), so decisions keep flipping
+*/
+
+#ifndef __ParameterSchedule_h__
+#define __ParameterSchedule_h__
+
+#include <stdint.h>
+#include <stdio.h>
+#include <vector>
+#include "StompBox.h"
+
+class PatchProcessor;
+
+class ParameterSchedule {
+private:
+  int blocks;
+  std::vector<float> values; // NOF_PARAMETERS per block
+public:
+  ParameterSchedule() : blocks(0) {}
+
+  static bool isTrajectoryName(const char* name);
+  static const char* getTrajectoryName(int index); // NULL past the last one
+
+  void generate(const char* trajectory, uint32_t seed, int blocks);
+
+  int getBlocks() const {
+    return blocks;
+  }
+  float getValue(int block, PatchParameterId pid) const {
+    return values[(size_t)block*NOF_PARAMETERS+pid];
+  }
+  void setValue(int block, PatchParameterId pid, float value);
+  void resize(int blocks);
+
+  // set the processor's parameters for the given block
+  void apply(PatchProcessor& processor, int block) const;
+
+  // one line per block: the NOF_PARAMETERS values, A first
+  void write(FILE* out, int lastBlock) const;
+  bool read(FILE* in);
+};
+
+#endif // __ParameterSchedule_h__
@@ -0,0 +1,338 @@
+/*
+ PatchBaseline: golden output and timing regression check for the patches.
+
+   PatchBaseline -u [options] [patch ...]   record the baseline
+   PatchBaseline [options] [patch ...]      check against it
+
+ Every patch renders a fixed corpus of inputs and parameter trajectories.
+ Recording stores a hash of each rendered output, the output itself as a
+ float WAV file, and the patch's cost per sample in the baseline directory.
+ Checking renders again: an output with the same hash is bit-exact,
+ otherwise it is compared sample by sample with the stored one and fails if
+ any sample is further off than the tolerance. A patch also fails if it got
+ slower than its baseline by more than the threshold. The exit status is
+ non-zero if any patch failed.
+
+ A patch that exposes its state is also snapshot half way through a run
+ and restored into a fresh instance, and both go on to render the second
+ half: their outputs must be identical. The first half holds parameter C
+ at 0.2, the second parks it at 0.26, past the 0.25 switch point of
+ chooseModel but inside its hysteresis, so a snapshot that forgets which
+ formant model the patch settled on shows up as a difference. A moves
+ from 0.5 to 0.6 at the same time, so that a patch that ramps its
+ coefficients across a change has a ramp to restore.
+
+ Timings only compare between runs on the same machine; record the
+ baseline before an optimisation and check after it.
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+#include "Benchmark.h"
+
+#define CORPUS_SEED 1
+#define CORPUS_SECONDS 1
+#define TIMING_SECONDS 2
+
+struct CorpusEntry {
+  const char* input;
+  const char* trajectory;
+};
+
+static const CorpusEntry corpus[] = {
+  { "noise", "static" },
+  { "noise", "random" },
+  { "sweep", "sweep" },
+  { "impulse", "static" },
+  { "burst", "jumps" }
+};
+
+static const int corpusSize = sizeof(corpus)/sizeof(corpus[0]);
+
+struct Baseline {
+  std::map<std::string, std::string> hashes;  // "patch input trajectory" to hash
+  std::map<std::string, double> timings;      // patch to ns per sample
+
+  bool read(const char* path);
+  bool write(const char* path);
+};
+
+bool Baseline::read(const char* path){
+  FILE* file = fopen(path, "r");
+  if(file == NULL)
+    return false;
+  char line[256];
+  char kind[16], patch[64], input[32], trajectory[32], hash[32];
+  double ns;
+  while(fgets(line, sizeof(line), file)){
+    if(line[0] == '#')
+      continue;
+    if(sscanf(line, "%15s", kind) != 1)
+      continue;
+    if(strcmp(kind, "output") == 0 &&
+       sscanf(line, "%*s %63s %31s %31s %31s", patch, input, trajectory, hash) == 4)
+      hashes[std::string(patch)+" "+input+" "+trajectory] = hash;
+    else if(strcmp(kind, "timing") == 0 && sscanf(line, "%*s %63s %lf", patch, &ns) == 2)
+      timings[patch] = ns;
+  }
+  fclose(file);
+  return true;
+}
+
+bool Baseline::write(const char* path){
+  FILE* file = fopen(path, "w");
+  if(file == NULL)
+    return false;
+  fprintf(file, "# output <patch> <input> <trajectory> <hash>\n");
+  fprintf(file, "# timing <patch> <ns per sample>\n");
+  for(std::map<std::string, std::string>::iterator it = hashes.begin(); it != hashes.end(); ++it)
+    fprintf(file, "output %s %s\n", it->first.c_str(), it->second.c_str());
+  for(std::map<std::string, double>::iterator it = timings.begin(); it != timings.end(); ++it)
+    fprintf(file, "timing %s %.3f\n", it->first.c_str(), it->second);
+  return fclose(file) == 0;
+}
+
+// 64 bit FNV-1a over the sample bits
+static std::string hashOutput(AudioData& data){
+  uint64_t hash = 14695981039346656037ULL;
+  const unsigned char* bytes = (const unsigned char*)&data.samples[0];
+  for(size_t i=0; i<data.samples.size()*sizeof(float); i++){
+    hash ^= bytes[i];
+    hash *= 1099511628211ULL;
+  }
+  char text[20];
+  snprintf(text, sizeof(text), "%016llx", (unsigned long long)hash);
+  return text;
+}
+
+// largest difference between two renders, or -1 if their shapes differ
+static double getMaxError(AudioData& a, AudioData& b){
+  if(a.channels != b.channels || a.length != b.length)
+    return -1;
+  double error = 0;
+  for(size_t i=0; i<a.samples.size(); i++)
+    error = std::max(error, (double)fabsf(a.samples[i]-b.samples[i]));
+  return error;
+}
+
+static void render(const PatchDefinition* def, const CorpusEntry& entry, double sampleRate,
+		   int blockSize, int channels, AudioData& output){
+  AudioData input;
+  generateSignal(entry.input, input, channels, (int)(CORPUS_SECONDS*sampleRate), sampleRate);
+  ParameterSchedule schedule;
+  schedule.generate(entry.trajectory, CORPUS_SEED, (input.length+blockSize-1)/blockSize);
+  PatchProcessor processor(sampleRate, blockSize);
+  processor.load(def);
+  runBenchmark(processor, input, 0, &output, &schedule);
+}
+
+// largest difference between a patch run on and a fresh instance restored
+// from its state half way, -1 for a patch without state
+static double checkRestore(const PatchDefinition* def, double sampleRate, int blockSize,
+			   int channels){
+  PatchProcessor serial(sampleRate, blockSize);
+  serial.load(def);
+  int stateSize = serial.getStateSize();
+  if(stateSize == 0)
+    return -1;
+  AudioData input, first, second, resumed;
+  generateSignal("noise", input, channels, (int)(CORPUS_SECONDS*sampleRate/2), sampleRate);
+  int blocks = (input.length+blockSize-1)/blockSize;
+  ParameterSchedule before, after;
+  before.resize(blocks);
+  after.resize(blocks);
+  for(int b=0; b<blocks; b++){
+    before.setValue(b, PARAMETER_C, 0.2f);
+    after.setValue(b, PARAMETER_A, 0.6f);
+    after.setValue(b, PARAMETER_C, 0.26f);
+  }
+  runBenchmark(serial, input, 0, &first, &before);
+  std::vector<float> state(stateSize);
+  serial.getState(&state[0]);
+  PatchProcessor restored(sampleRate, blockSize);
+  restored.load(def);
+  restored.setState(&state[0]);
+  runBenchmark(serial, input, 0, &second, &after);
+  runBenchmark(restored, input, 0, &resumed, &after);
+  return getMaxError(second, resumed);
+}
+
+static double measure(const PatchDefinition* def, double sampleRate, int blockSize,
+		      int channels, int runs){
+  AudioData input;
+  generateSignal("noise", input, channels, (int)(TIMING_SECONDS*sampleRate), sampleRate);
+  // the best run is the one least disturbed by other load on the machine
+  std::vector<double> ns;
+  for(int i=0; i<runs; i++){
+    PatchProcessor processor(sampleRate, blockSize);
+    processor.load(def);
+    ns.push_back(runBenchmark(processor, input, 16).getNsPerSample());
+  }
+  return *std::min_element(ns.begin(), ns.end());
+}
+
+static void usage(const char* name){
+  fprintf(stderr,
+	  "usage: %s [options] [patch ...]\n"
+	  "  -u          record (update) the baseline instead of checking against it\n"
+	  "  -d dir      baseline directory (default Baseline)\n"
+	  "  -t error    largest sample difference accepted (default 1e-5)\n"
+	  "  -x percent  slowdown accepted (default 10)\n"
+	  "  -n runs     timing runs, the fastest is used (default 7)\n"
+	  "  -r rate     sample rate in Hz (default 48000)\n"
+	  "  -b size     block size in samples (default 128)\n"
+	  "  -c channels number of channels (default 2)\n",
+	  name);
+}
+
+int main(int argc, char** argv){
+  bool update = false;
+  std::string dir = "Baseline";
+  double tolerance = 1e-5;
+  double slowdown = 10;
+  int runs = 7;
+  double sampleRate = 48000;
+  int blockSize = 128;
+  int channels = 2;
+  int opt;
+  while((opt = getopt(argc, argv, "ud:t:x:n:r:b:c:h")) != -1){
+    switch(opt){
+    case 'u':
+      update = true;
+      break;
+    case 'd':
+      dir = optarg;
+      break;
+    case 't':
+      tolerance = atof(optarg);
+      break;
+    case 'x':
+      slowdown = atof(optarg);
+      break;
+    case 'n':
+      runs = atoi(optarg);
+      break;
+    case 'r':
+      sampleRate = atof(optarg);
+      break;
+    case 'b':
+      blockSize = atoi(optarg);
+      break;
+    case 'c':
+      channels = atoi(optarg);
+      break;
+    default:
+      usage(argv[0]);
+      return 1;
+    }
+  }
+  if(blockSize < 2 || channels < 1 || sampleRate <= 0 || runs < 1){
+    usage(argv[0]);
+    return 1;
+  }
+
+  std::vector<const PatchDefinition*> patches;
+  for(int i=optind; i<argc; i++){
+    const PatchDefinition* def = PatchRegistry::getPatch(argv[i]);
+    if(def == NULL){
+      fprintf(stderr, "unknown patch: %s\n", argv[i]);
+      return 1;
+    }
+    patches.push_back(def);
+  }
+  if(patches.empty())
+    for(int i=0; i<PatchRegistry::getNumberOfPatches(); i++)
+      patches.push_back(PatchRegistry::getPatch(i));
+
+  Baseline baseline;
+  std::string index = dir+"/baseline.txt";
+  if(!baseline.read(index.c_str()) && !update){
+    fprintf(stderr, "no baseline in %s, record one with -u\n", dir.c_str());
+    return 1;
+  }
+  if(update){
+    mkdir(dir.c_str(), 0777);
+    printf("recording baseline in %s\n", dir.c_str());
+  }else
+    printf("checking against %s: tolerance %g, slowdown %.0f%%\n", dir.c_str(), tolerance, slowdown);
+  printf("%-32s %-28s %12s %12s  %s\n", "patch", "output", "ns/sample", "baseline", "status");
+
+  int failures = 0;
+  for(size_t i=0; i<patches.size(); i++){
+    const PatchDefinition* def = patches[i];
+    std::string status;
+    int exact = 0;
+    double worstError = 0;
+    for(int c=0; c<corpusSize; c++){
+      const CorpusEntry& entry = corpus[c];
+      AudioData output;
+      render(def, entry, sampleRate, blockSize, channels, output);
+      std::string key = std::string(def->name)+" "+entry.input+" "+entry.trajectory;
+      std::string golden = dir+"/"+def->name+"."+entry.input+"."+entry.trajectory+".wav";
+      std::string hash = hashOutput(output);
+      if(update){
+	if(!writeWavFile(golden.c_str(), output)){
+	  fprintf(stderr, "cannot write %s\n", golden.c_str());
+	  return 1;
+	}
+	baseline.hashes[key] = hash;
+	continue;
+      }
+      if(baseline.hashes.count(key) == 0){
+	status += "no baseline for "+std::string(entry.input)+"/"+entry.trajectory+" ";
+	continue;
+      }
+      if(baseline.hashes[key] == hash){
+	exact++;
+	continue;
+      }
+      AudioData reference;
+      double error = readWavFile(golden.c_str(), reference) ? getMaxError(output, reference) : -1;
+      if(error < 0)
+	status += "cannot compare "+std::string(entry.input)+"/"+entry.trajectory+" ";
+      else if(error > tolerance)
+	status += "drift on "+std::string(entry.input)+"/"+entry.trajectory+" ";
+      worstError = std::max(worstError, error);
+    }
+    if(checkRestore(def, sampleRate, blockSize, channels) > 0)
+      status += "restore differs ";
+
+    double ns = measure(def, sampleRate, blockSize, channels, runs);
+    double reference = baseline.timings.count(def->name) ? baseline.timings[def->name] : 0;
+    if(update)
+      baseline.timings[def->name] = ns;
+    else if(reference == 0)
+      status += "no timing baseline ";
+    else if(ns > reference*(1+slowdown/100))
+      status += "slower ";
+
+    char output[48];
+    if(update)
+      snprintf(output, sizeof(output), "recorded");
+    else if(exact == corpusSize)
+      snprintf(output, sizeof(output), "bit-exact");
+    else
+      snprintf(output, sizeof(output), "%d/%d exact, max error %.1e", exact, corpusSize, worstError);
+    if(status.empty())
+      status = "ok";
+    else
+      failures++;
+    if(reference > 0 && !update)
+      printf("%-32s %-28s %12.2f %12.2f  %+.1f%% %s\n", def->name, output, ns, reference,
+	     100*(ns/reference-1), status.c_str());
+    else
+      printf("%-32s %-28s %12.2f %12s  %s\n", def->name, output, ns, "-", status.c_str());
+  }
+
+  if(update && !baseline.write(index.c_str())){
+    fprintf(stderr, "cannot write %s\n", index.c_str());
+    return 1;
+  }
+  return failures ? 1 : 0;
+}
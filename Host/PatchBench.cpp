@@ -0,0 +1,227 @@
+/*
+ PatchBench: runs the patches of this repository off the pedal and reports
+ how long processAudio takes.
+
+   PatchBench [options] [patch ...]
+
+ With no patch names every registered patch is measured. For each patch the
+ report gives the mean cost per sample frame, the realtime factor (seconds
+ of audio per second of CPU) and the slowest single block, next to the
+ block budget of blocksize/samplerate. Built with COEFFS_CACHE=1, patches
+ whose filters cache their coefficients (the EQs) also show the share of
+ designs skipped.
+
+ With -S each patch is instead run at every power of two block size from 8
+ to 2048, and cost per sample is plotted against block size. Fixed per-block
+ work (coefficient updates, prepare(), FFT setup) shows as cost rising at
+ small blocks; the smallest block whose worst block stays within the load
+ limit is reported as the patch's lowest usable latency.
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <vector>
+#include "Benchmark.h"
+#include "CoeffsCacheStats.h"
+#include "ProfileStage.h"
+
+#define SWEEP_MIN_BLOCK 8
+#define SWEEP_MAX_BLOCK 2048
+#define SWEEP_BAR 40
+
+static void usage(const char* name){
+  fprintf(stderr,
+	  "usage: %s [options] [patch ...]\n"
+	  "  -l          list registered patches and exit\n"
+	  "  -i input    noise, sine, sweep, impulse, silence, burst, or a .wav / raw float32 file (default noise)\n"
+	  "  -s seconds  length of synthetic input (default 10)\n"
+	  "  -r rate     sample rate in Hz (default 48000)\n"
+	  "  -b size     block size in samples (default 128)\n"
+	  "  -c channels number of channels (default 2)\n"
+	  "  -w blocks   untimed warm-up blocks (default 16)\n"
+	  "  -p X=value  set parameter X (A to H) to value, 0.0 to 1.0 (default 0.5)\n"
+	  "  -S          sweep block sizes %d to %d instead of using -b\n"
+	  "  -u percent  worst block load limit for the sweep (default 100)\n",
+	  name, SWEEP_MIN_BLOCK, SWEEP_MAX_BLOCK);
+}
+
+static void listPatches(){
+  for(int i=0; i<PatchRegistry::getNumberOfPatches(); i++)
+    printf("%s\n", PatchRegistry::getPatch(i)->name);
+}
+
+static bool setParameters(PatchProcessor& processor, std::vector<const char*>& parameters){
+  for(size_t p=0; p<parameters.size(); p++){
+    if(!processor.setParameter(parameters[p])){
+      fprintf(stderr, "bad parameter: %s\n", parameters[p]);
+      return false;
+    }
+  }
+  return true;
+}
+
+static bool sweepBlockSizes(const PatchDefinition* def, AudioData& input, int warmup,
+			    std::vector<const char*>& parameters, double loadLimit){
+  double sampleRate = input.sampleRate;
+  std::vector<int> sizes;
+  std::vector<BenchmarkResult> results;
+  double worst = 0;
+  for(int blockSize=SWEEP_MIN_BLOCK; blockSize<=SWEEP_MAX_BLOCK; blockSize *= 2){
+    PatchProcessor processor(sampleRate, blockSize);
+    processor.load(def);
+    if(!setParameters(processor, parameters))
+      return false;
+    // the same number of seconds warm-up at every size
+    int blocks = warmup*128/blockSize;
+    BenchmarkResult result = runBenchmark(processor, input, blocks > 1 ? blocks : 1);
+    sizes.push_back(blockSize);
+    results.push_back(result);
+    worst = fmax(worst, result.getNsPerSample());
+  }
+  printf("\n%s\n%8s %12s %12s %12s\n", def->name, "block", "latency ms", "ns/sample", "worst load");
+  int smallest = 0;
+  for(size_t i=0; i<sizes.size(); i++){
+    double nsPerSample = results[i].getNsPerSample();
+    double load = 100*results[i].worstNs/BenchmarkResult::getBudgetNs(sizes[i], sampleRate);
+    if(smallest == 0 && load <= loadLimit)
+      smallest = sizes[i];
+    int bar = worst > 0 ? (int)(SWEEP_BAR*nsPerSample/worst+0.5) : 0;
+    printf("%8d %12.2f %12.2f %11.1f%%  %.*s\n", sizes[i], 1e3*sizes[i]/sampleRate,
+	   nsPerSample, load, bar, "########################################");
+  }
+  if(smallest)
+    printf("smallest block within %.0f%% load: %d (%.2f ms)\n", loadLimit,
+	   smallest, 1e3*smallest/sampleRate);
+  else
+    printf("no block size within %.0f%% load\n", loadLimit);
+  return true;
+}
+
+int main(int argc, char** argv){
+  const char* inputSpec = "noise";
+  double seconds = 10;
+  double sampleRate = 48000;
+  int blockSize = 128;
+  int channels = 2;
+  int warmup = 16;
+  bool sweep = false;
+  double loadLimit = 100;
+  std::vector<const char*> parameters;
+  int opt;
+  while((opt = getopt(argc, argv, "li:s:r:b:c:w:p:Su:h")) != -1){
+    switch(opt){
+    case 'l':
+      listPatches();
+      return 0;
+    case 'i':
+      inputSpec = optarg;
+      break;
+    case 's':
+      seconds = atof(optarg);
+      break;
+    case 'r':
+      sampleRate = atof(optarg);
+      break;
+    case 'b':
+      blockSize = atoi(optarg);
+      break;
+    case 'c':
+      channels = atoi(optarg);
+      break;
+    case 'w':
+      warmup = atoi(optarg);
+      break;
+    case 'p':
+      parameters.push_back(optarg);
+      break;
+    case 'S':
+      sweep = true;
+      break;
+    case 'u':
+      loadLimit = atof(optarg);
+      break;
+    default:
+      usage(argv[0]);
+      return 1;
+    }
+  }
+  if(blockSize < 2 || channels < 1 || sampleRate <= 0){
+    usage(argv[0]);
+    return 1;
+  }
+
+  std::vector<const PatchDefinition*> patches;
+  for(int i=optind; i<argc; i++){
+    const PatchDefinition* def = PatchRegistry::getPatch(argv[i]);
+    if(def == NULL){
+      fprintf(stderr, "unknown patch: %s\n", argv[i]);
+      return 1;
+    }
+    patches.push_back(def);
+  }
+  if(patches.empty())
+    for(int i=0; i<PatchRegistry::getNumberOfPatches(); i++)
+      patches.push_back(PatchRegistry::getPatch(i));
+
+  AudioData input;
+  if(!loadInput(inputSpec, input, channels, (int)(seconds*sampleRate), sampleRate)){
+    fprintf(stderr, "cannot read input: %s\n", inputSpec);
+    return 1;
+  }
+  // file input keeps its own rate so that realtime figures stay meaningful
+  sampleRate = input.sampleRate;
+
+  if(sweep){
+    printf("input %s, %d channels, %.2f s at %.0f Hz, block sizes %d to %d\n",
+	   inputSpec, input.channels, input.length/sampleRate, sampleRate,
+	   SWEEP_MIN_BLOCK, SWEEP_MAX_BLOCK);
+    for(size_t i=0; i<patches.size(); i++)
+      if(!sweepBlockSizes(patches[i], input, warmup, parameters, loadLimit))
+	return 1;
+    return 0;
+  }
+
+#ifdef PROFILE_STAGES
+  if(!StageProfiler::open())
+    fprintf(stderr, "no hardware counters (%s), timing stages with the cycle counter only\n",
+	    StageProfiler::getError());
+#endif
+  printf("input %s, %d channels, %.2f s at %.0f Hz, block size %d (budget %.1f us)\n",
+	 inputSpec, input.channels, input.length/sampleRate, sampleRate, blockSize,
+	 BenchmarkResult::getBudgetNs(blockSize, sampleRate)*1e-3);
+  printf("%-32s %12s %10s %16s %12s %12s\n",
+	 "patch", "ns/sample", "realtime", "worst block us", "worst load", "cache hits");
+#ifdef BLOCK_LOAD_MONITOR
+  std::vector<BlockLoadMonitor> loads;
+#endif
+  for(size_t i=0; i<patches.size(); i++){
+    PatchProcessor processor(sampleRate, blockSize);
+    processor.load(patches[i]);
+    if(!setParameters(processor, parameters))
+      return 1;
+    BenchmarkResult result = runBenchmark(processor, input, warmup);
+    double budget = BenchmarkResult::getBudgetNs(blockSize, sampleRate);
+    printf("%-32s %12.2f %9.1fx %16.2f %11.1f%%",
+	   patches[i]->name, result.getNsPerSample(),
+	   result.getRealtimeFactor(sampleRate), result.worstNs*1e-3,
+	   100*result.worstNs/budget);
+    if(CoeffsCacheStats::getHitRate() >= 0)
+      printf(" %11.1f%%\n", CoeffsCacheStats::getHitRate());
+    else
+      printf(" %12s\n", "-");
+#ifdef PROFILE_STAGES
+    StageProfiler::print(stdout);
+#endif
+#ifdef BLOCK_LOAD_MONITOR
+    loads.push_back(processor.getLoadMonitor());
+#endif
+  }
+#ifdef BLOCK_LOAD_MONITOR
+  printf("\nblock load, cycle counter at %.0f MHz\n", getCycleFrequency()*1e-6);
+  BlockLoadMonitor::printHeader(stdout);
+  for(size_t i=0; i<patches.size(); i++)
+    loads[i].print(stdout, patches[i]->name);
+#endif
+  return 0;
+}
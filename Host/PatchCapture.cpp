@@ -0,0 +1,141 @@
+#include "PatchCapture.h"
+#include <string.h>
+
+static const char magic[6] = { 'O', 'W', 'L', 'C', 'A', 'P' };
+#define CAPTURE_VERSION 1
+
+bool CaptureWriter::open(const char* path, const char* patch, double sampleRate,
+			 int size, int ch, CaptureFormat fmt){
+  close();
+  file = fopen(path, "wb");
+  if(file == NULL)
+    return false;
+  blockSize = size;
+  channels = ch;
+  format = fmt;
+  blocks = 0;
+  pcm.resize((size_t)channels*blockSize);
+  uint8_t version[2] = { CAPTURE_VERSION, (uint8_t)format };
+  uint32_t length = blockSize;
+  uint16_t counts[2] = { (uint16_t)channels, 0 };
+  float rate = sampleRate;
+  char name[48] = { 0 };
+  strncpy(name, patch, sizeof(name)-1);
+  fwrite(magic, 1, sizeof(magic), file);
+  fwrite(version, 1, sizeof(version), file);
+  fwrite(&length, sizeof(length), 1, file);
+  fwrite(counts, sizeof(counts), 1, file);
+  fwrite(&rate, sizeof(rate), 1, file);
+  return fwrite(name, sizeof(name), 1, file) == 1;
+}
+
+bool CaptureWriter::writeBlock(const float* parameters, AudioBuffer& input){
+  if(file == NULL || input.getChannels() < channels || input.getSize() != blockSize)
+    return false;
+  uint8_t mask = 0;
+  for(int p=0; p<NOF_PARAMETERS; p++)
+    if(blocks == 0 || parameters[p] != previous[p])
+      mask |= 1 << p;
+  fwrite(&mask, 1, 1, file);
+  for(int p=0; p<NOF_PARAMETERS; p++){
+    if(mask & (1 << p))
+      fwrite(&parameters[p], sizeof(float), 1, file);
+    previous[p] = parameters[p];
+  }
+  size_t written = 0;
+  if(format == CAPTURE_INT16){
+    for(int ch=0; ch<channels; ch++){
+      float* samples = input.getSamples(ch);
+      for(int i=0; i<blockSize; i++){
+	float value = samples[i]*32768.0f;
+	value = value > 32767.0f ? 32767.0f : value < -32768.0f ? -32768.0f : value;
+	pcm[ch*blockSize+i] = (int16_t)lrintf(value);
+      }
+    }
+    written = fwrite(&pcm[0], sizeof(int16_t), pcm.size(), file);
+  }else{
+    for(int ch=0; ch<channels; ch++)
+      written += fwrite((float*)input.getSamples(ch), sizeof(float), blockSize, file);
+  }
+  blocks++;
+  return written == (size_t)channels*blockSize;
+}
+
+bool CaptureWriter::close(){
+  if(file == NULL)
+    return true;
+  bool ok = fclose(file) == 0;
+  file = NULL;
+  return ok;
+}
+
+bool readCapture(const char* path, CaptureHeader& header, AudioData& input,
+		 ParameterSchedule& schedule){
+  FILE* file = fopen(path, "rb");
+  if(file == NULL)
+    return false;
+  char id[sizeof(magic)];
+  uint8_t version[2];
+  uint32_t length;
+  uint16_t counts[2];
+  float rate;
+  bool ok = fread(id, sizeof(id), 1, file) == 1 && memcmp(id, magic, sizeof(magic)) == 0 &&
+    fread(version, sizeof(version), 1, file) == 1 && version[0] == CAPTURE_VERSION &&
+    version[1] <= CAPTURE_INT16 &&
+    fread(&length, sizeof(length), 1, file) == 1 &&
+    fread(counts, sizeof(counts), 1, file) == 1 &&
+    fread(&rate, sizeof(rate), 1, file) == 1 &&
+    fread(header.patch, sizeof(header.patch), 1, file) == 1 &&
+    length > 0 && counts[0] > 0;
+  if(!ok){
+    fclose(file);
+    return false;
+  }
+  header.patch[sizeof(header.patch)-1] = '\0';
+  header.sampleRate = rate;
+  header.blockSize = length;
+  header.channels = counts[0];
+  header.format = (CaptureFormat)version[1];
+
+  // blocks are read into per-channel lists first, the total is not stored
+  int blockSize = header.blockSize;
+  int channels = header.channels;
+  std::vector<float> parameters;
+  std::vector<std::vector<float> > audio(channels);
+  std::vector<float> block((size_t)channels*blockSize);
+  std::vector<int16_t> pcm((size_t)channels*blockSize);
+  float current[NOF_PARAMETERS] = { 0 };
+  uint8_t mask;
+  while(fread(&mask, 1, 1, file) == 1){
+    for(int p=0; p<NOF_PARAMETERS; p++)
+      if((mask & (1 << p)) && fread(&current[p], sizeof(float), 1, file) != 1)
+	ok = false;
+    if(header.format == CAPTURE_INT16){
+      if(fread(&pcm[0], sizeof(int16_t), pcm.size(), file) != pcm.size())
+	ok = false;
+      for(size_t i=0; i<pcm.size(); i++)
+	block[i] = pcm[i]*(1.0f/32768.0f);
+    }else if(fread(&block[0], sizeof(float), block.size(), file) != block.size()){
+      ok = false;
+    }
+    if(!ok)
+      break;
+    parameters.insert(parameters.end(), current, current+NOF_PARAMETERS);
+    for(int ch=0; ch<channels; ch++)
+      audio[ch].insert(audio[ch].end(), &block[ch*blockSize], &block[(ch+1)*blockSize]);
+  }
+  fclose(file);
+  int blocks = parameters.size()/NOF_PARAMETERS;
+  if(!ok || blocks == 0)
+    return false;
+
+  input.allocate(channels, blocks*blockSize);
+  input.sampleRate = header.sampleRate;
+  for(int ch=0; ch<channels; ch++)
+    memcpy(input.getChannel(ch), &audio[ch][0], audio[ch].size()*sizeof(float));
+  schedule.resize(blocks);
+  for(int b=0; b<blocks; b++)
+    for(int p=0; p<NOF_PARAMETERS; p++)
+      schedule.setValue(b, (PatchParameterId)p, parameters[b*NOF_PARAMETERS+p]);
+  return true;
+}
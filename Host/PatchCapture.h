@@ -0,0 +1,68 @@
+/*
+ Capture of exactly what a patch was given: the parameter values and the
+ input audio of every block, so that a glitch can be replayed block for
+ block on the host (see PatchReplay).
+
+ File layout, little-endian:
+   "OWLCAP", version byte (1), format byte (0 float32, 1 int16)
+   uint32 block size, uint16 channels, uint16 zero, float32 sample rate
+   char[48] patch name, zero padded
+ then per block:
+   uint8 mask of the parameters that changed since the previous block (A is
+   bit 0; all set for the first block), a float32 for each set bit, then
+   channels*blocksize samples, one channel after the other.
+
+ Parameters cost one byte for a block where no knob moved, so the audio
+ dominates the size; int16 halves it at the cost of bit-exact input.
+*/
+
+#ifndef __PatchCapture_h__
+#define __PatchCapture_h__
+
+#include <stdint.h>
+#include <stdio.h>
+#include <vector>
+#include "StompBox.h"
+#include "AudioData.h"
+#include "ParameterSchedule.h"
+
+enum CaptureFormat {
+  CAPTURE_FLOAT32 = 0,
+  CAPTURE_INT16 = 1
+};
+
+struct CaptureHeader {
+  char patch[48];
+  double sampleRate;
+  int blockSize;
+  int channels;
+  CaptureFormat format;
+};
+
+class CaptureWriter {
+private:
+  FILE* file;
+  int blockSize;
+  int channels;
+  CaptureFormat format;
+  int blocks;
+  float previous[NOF_PARAMETERS];
+  std::vector<int16_t> pcm;
+public:
+  CaptureWriter() : file(NULL), blocks(0) {}
+  ~CaptureWriter(){
+    close();
+  }
+  bool open(const char* path, const char* patch, double sampleRate, int blockSize,
+	    int channels, CaptureFormat format);
+  // the NOF_PARAMETERS values and the input the patch is about to process
+  bool writeBlock(const float* parameters, AudioBuffer& input);
+  bool close();
+};
+
+// fills 'input' with the captured audio and 'schedule' with one row of
+// parameters per block
+bool readCapture(const char* path, CaptureHeader& header, AudioData& input,
+		 ParameterSchedule& schedule);
+
+#endif // __PatchCapture_h__
@@ -0,0 +1,325 @@
+/*
+ PatchConsole: runs one patch on many channels at once, as a strip of a
+ mixing console, and shows how the cost per channel holds up as the
+ channel count grows.
+
+   PatchConsole [options] patch
+
+ Channels are grouped into patch instances of -g channels each (2 by
+ default, a stereo pair; the EQ patches take up to EQ_CHANNELS, see the
+ Makefile). The groups are split into contiguous partitions, one per
+ worker thread, and every worker is pinned to its own core and creates
+ its instances and buffers there. The main thread is worker 0. Each block
+ the main thread releases the workers by bumping a generation counter,
+ processes its own partition and waits until every worker has checked
+ in, so a block is done when its slowest partition is: the barrier cost
+ and any imbalance show up in the block time, as they would in a console
+ engine with a hard deadline. Waiting spins briefly, then yields.
+
+ The channel count doubles from one group up to -n channels, rounded
+ down to a whole number of groups. Each line gives the wall time per
+ channel and sample, its ratio to the first line (flat scaling stays near
+ 1.00 until the cores run out), and the mean and worst block time against
+ the block's real time budget. -V renders each group on its own
+ afterwards and checks the pooled output is identical.
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sched.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "AudioData.h"
+#include "HostClock.h"
+#include "PatchProcessor.h"
+#include "SampleBuffer.h"
+
+#define MAX_CHANNELS 64
+#define WARMUP_BLOCKS 16
+#define SPIN_LIMIT 1000
+
+struct ConsoleSettings {
+  const PatchDefinition* patch;
+  std::vector<const char*> parameters;
+  int blockSize;
+  int group; // channels per patch instance
+  AudioData input;
+};
+
+static void pinToCore(int core){
+  int cores = std::thread::hardware_concurrency();
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(core % max(1, cores), &set);
+  pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+}
+
+static void wait(std::atomic<int>& value, int until){
+  for(int spins=0; value.load(std::memory_order_acquire) != until; spins++)
+    if(spins >= SPIN_LIMIT)
+      std::this_thread::yield();
+}
+
+class ChannelPool {
+private:
+  const ConsoleSettings& settings;
+  AudioData& output;
+  int workers;
+  int groups;
+  std::vector<std::thread> threads;
+  std::atomic<int> generation; // block to process plus one, -1 to stop
+  std::atomic<int> arrived;
+
+  // the partition of worker t, created on its thread
+  struct Partition {
+    std::vector<PatchProcessor*> processors;
+    std::vector<SampleBuffer*> buffers;
+    std::vector<float*> inputs, outputs; // settings.group channels per instance
+    int firstGroup;
+  };
+  std::vector<Partition> partitions;
+
+  void setup(int t){
+    pinToCore(t);
+    Partition& part = partitions[t];
+    part.firstGroup = t*groups/workers;
+    int end = (t+1)*groups/workers;
+    for(int g=part.firstGroup; g<end; g++){
+      PatchProcessor* processor = new PatchProcessor(settings.input.sampleRate, settings.blockSize);
+      processor->load(settings.patch);
+      for(size_t p=0; p<settings.parameters.size(); p++)
+	processor->setParameter(settings.parameters[p]);
+      part.processors.push_back(processor);
+      part.buffers.push_back(new SampleBuffer(settings.group, settings.blockSize));
+      for(int ch=g*settings.group; ch<(g+1)*settings.group; ch++){
+	part.inputs.push_back(const_cast<AudioData&>(settings.input).getChannel(ch));
+	part.outputs.push_back(output.getChannel(ch));
+      }
+    }
+  }
+
+  void process(int t, int block){
+    Partition& part = partitions[t];
+    int pos = block*settings.blockSize;
+    int length = min(settings.blockSize, settings.input.length-pos);
+    for(size_t i=0; i<part.processors.size(); i++){
+      part.buffers[i]->load(&part.inputs[i*settings.group], pos, length);
+      part.processors[i]->process(*part.buffers[i]);
+      part.buffers[i]->store(&part.outputs[i*settings.group], pos, length);
+    }
+  }
+
+  void run(int t){
+    setup(t);
+    arrived.fetch_add(1, std::memory_order_release);
+    for(int seen=0;;){
+      for(int spins=0; generation.load(std::memory_order_acquire) == seen; spins++)
+	if(spins >= SPIN_LIMIT)
+	  std::this_thread::yield();
+      seen = generation.load(std::memory_order_acquire);
+      if(seen < 0)
+	return;
+      process(t, seen-1);
+      arrived.fetch_add(1, std::memory_order_release);
+    }
+  }
+
+public:
+  ChannelPool(const ConsoleSettings& s, AudioData& out, int channels, int threadCount)
+    : settings(s), output(out), generation(0), arrived(0) {
+    groups = channels/settings.group;
+    workers = max(1, min(threadCount, groups));
+    partitions.resize(workers);
+    setup(0);
+    for(int t=1; t<workers; t++)
+      threads.push_back(std::thread(&ChannelPool::run, this, t));
+    wait(arrived, workers-1);
+  }
+
+  ~ChannelPool(){
+    generation.store(-1, std::memory_order_release);
+    for(size_t t=0; t<threads.size(); t++)
+      threads[t].join();
+    for(size_t t=0; t<partitions.size(); t++){
+      for(size_t i=0; i<partitions[t].processors.size(); i++){
+	delete partitions[t].processors[i];
+	delete partitions[t].buffers[i];
+      }
+    }
+  }
+
+  int getWorkers() const {
+    return workers;
+  }
+
+  // one block on every channel; returns once all partitions are done
+  void processBlock(int block){
+    arrived.store(0, std::memory_order_relaxed);
+    generation.store(block+1, std::memory_order_release);
+    process(0, block);
+    wait(arrived, workers-1);
+  }
+};
+
+// renders each group serially on a fresh instance; true if identical
+static bool verify(ConsoleSettings& settings, AudioData& output, int channels){
+  AudioData single;
+  for(int channel=0; channel<channels; channel += settings.group){
+    AudioData input;
+    input.allocate(settings.group, settings.input.length);
+    input.sampleRate = settings.input.sampleRate;
+    for(int ch=0; ch<settings.group; ch++)
+      memcpy(input.getChannel(ch), settings.input.getChannel(channel+ch),
+	     input.length*sizeof(float));
+    PatchProcessor processor(input.sampleRate, settings.blockSize);
+    processor.load(settings.patch);
+    for(size_t p=0; p<settings.parameters.size(); p++)
+      processor.setParameter(settings.parameters[p]);
+    SampleBuffer buffer(settings.group, settings.blockSize);
+    std::vector<float*> in(settings.group);
+    for(int ch=0; ch<settings.group; ch++)
+      in[ch] = input.getChannel(ch);
+    for(int pos=0; pos<input.length; pos += settings.blockSize){
+      int length = min(settings.blockSize, input.length-pos);
+      buffer.load(&in[0], pos, length);
+      processor.process(buffer);
+      buffer.store(&in[0], pos, length);
+    }
+    for(int ch=0; ch<settings.group; ch++)
+      if(memcmp(input.getChannel(ch), output.getChannel(channel+ch), input.length*sizeof(float)))
+	return false;
+  }
+  return true;
+}
+
+static void usage(const char* name){
+  fprintf(stderr,
+	  "usage: %s [options] patch\n"
+	  "  -n channels largest channel count (default 64, at most %d)\n"
+	  "  -g channels channels per patch instance (default 2)\n"
+	  "  -j threads  worker threads, pinned one per core (default one per core)\n"
+	  "  -p X=value  set parameter X (A to H) to value, 0.0 to 1.0 (default 0.5)\n"
+	  "  -s seconds  length of noise input per channel count (default 2)\n"
+	  "  -r rate     sample rate in Hz (default 48000)\n"
+	  "  -b size     block size in samples (default 128)\n"
+	  "  -V          check the pooled output against each group rendered alone\n",
+	  name, MAX_CHANNELS);
+}
+
+int main(int argc, char** argv){
+  ConsoleSettings settings;
+  settings.blockSize = 128;
+  settings.group = 2;
+  int maxChannels = MAX_CHANNELS;
+  int threads = std::thread::hardware_concurrency();
+  double seconds = 2;
+  double sampleRate = 48000;
+  bool check = false;
+  int opt;
+  while((opt = getopt(argc, argv, "n:g:j:p:s:r:b:Vh")) != -1){
+    switch(opt){
+    case 'n':
+      maxChannels = atoi(optarg);
+      break;
+    case 'g':
+      settings.group = atoi(optarg);
+      break;
+    case 'j':
+      threads = atoi(optarg);
+      break;
+    case 'p':
+      settings.parameters.push_back(optarg);
+      break;
+    case 's':
+      seconds = atof(optarg);
+      break;
+    case 'r':
+      sampleRate = atof(optarg);
+      break;
+    case 'b':
+      settings.blockSize = atoi(optarg);
+      break;
+    case 'V':
+      check = true;
+      break;
+    default:
+      usage(argv[0]);
+      return 1;
+    }
+  }
+  if(optind != argc-1 || settings.blockSize < 2 || sampleRate <= 0 || seconds <= 0 ||
+     settings.group < 1 || maxChannels < settings.group || maxChannels > MAX_CHANNELS){
+    usage(argv[0]);
+    return 1;
+  }
+  maxChannels -= maxChannels % settings.group;
+  settings.patch = PatchRegistry::getPatch(argv[optind]);
+  if(settings.patch == NULL){
+    fprintf(stderr, "unknown patch: %s\n", argv[optind]);
+    return 1;
+  }
+  PatchProcessor probe(sampleRate, settings.blockSize);
+  for(size_t p=0; p<settings.parameters.size(); p++){
+    if(!probe.setParameter(settings.parameters[p])){
+      fprintf(stderr, "bad parameter: %s\n", settings.parameters[p]);
+      return 1;
+    }
+  }
+  generateSignal("noise", settings.input, maxChannels, (int)(seconds*sampleRate), sampleRate);
+  int blocks = (settings.input.length+settings.blockSize-1)/settings.blockSize;
+  if(blocks <= WARMUP_BLOCKS){
+    fprintf(stderr, "input shorter than the warm-up\n");
+    return 1;
+  }
+  double budget = settings.blockSize*1e9/sampleRate;
+  pinToCore(0);
+
+  printf("%s: %d channels per instance, block %d, %.1f us budget per block\n",
+	 settings.patch->name, settings.group, settings.blockSize, budget*1e-3);
+  printf("%8s %8s %12s %8s %10s %10s %8s%s\n", "channels", "workers", "ns/ch/smp",
+	 "ratio", "mean us", "worst us", "load", check ? "   output" : "");
+  double first = 0;
+  int failures = 0;
+  for(int channels=settings.group; channels<=maxChannels; ){
+    AudioData output;
+    output.allocate(channels, settings.input.length);
+    output.sampleRate = sampleRate;
+    int workers;
+    uint64_t total = 0, worst = 0;
+    {
+      ChannelPool pool(settings, output, channels, threads);
+      workers = pool.getWorkers();
+      for(int block=0; block<blocks; block++){
+	uint64_t start = getNanoseconds();
+	pool.processBlock(block);
+	uint64_t ns = getNanoseconds()-start;
+	if(block >= WARMUP_BLOCKS){
+	  total += ns;
+	  worst = max(worst, ns);
+	}
+      }
+    }
+    int timed = blocks-WARMUP_BLOCKS;
+    double perSample = (double)total/((double)timed*settings.blockSize*channels);
+    if(first == 0)
+      first = perSample;
+    printf("%8d %8d %12.2f %8.2f %10.1f %10.1f %7.1f%%", channels, workers, perSample,
+	   perSample/first, total*1e-3/timed, worst*1e-3, 100*total/(timed*budget));
+    if(check){
+      bool same = verify(settings, output, channels);
+      printf("   %s", same ? "same" : "DIFFERS");
+      failures += !same;
+    }
+    printf("\n");
+    int next = min(maxChannels, channels*2);
+    next -= next % settings.group;
+    if(next <= channels)
+      break;
+    channels = next;
+  }
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,75 @@
+/*
+ Generic translation unit that compiles one patch header and registers it.
+ The Makefile builds this file once per patch with
+   -DPATCH_CLASS=<class name> -DPATCH_HEADER='"<class name>.hpp"'
+ The patch is wrapped in its own namespace so that the filter classes that
+ several patches define (BiquadDF1, SampleBasedPatch, ...) do not collide
+ when all of them are linked into one binary. Headers the patches include
+ are pulled in here first so that they stay outside that namespace.
+*/
+
+#include "StompBox.h"
+#include "FastFourierTransform.h"
+#include "PatchRegistry.h"
+#include "ProfileStage.h"
+#include "BiquadLanes.h"
+#include "CoeffsCache.h"
+#include "FastMath.h"
+#include "BiquadStateSpace.h"
+#include "BiquadLookahead.h"
+#include "BiquadBank.h"
+#include "DenormalGuard.h"
+#include "BiquadQ31.h"
+
+#define PATCH_STRING_(x) #x
+#define PATCH_STRING(x) PATCH_STRING_(x)
+#ifdef PATCH_VARIANT
+// the same header built again with other flags, -DPATCH_VARIANT=<variant>
+#define PATCH_NAMESPACE__(c, v) c##_##v##_host
+#define PATCH_NAMESPACE_(c, v) PATCH_NAMESPACE__(c, v)
+#define PATCH_NAMESPACE(c) PATCH_NAMESPACE_(c, PATCH_VARIANT)
+#define PATCH_NAME PATCH_STRING(PATCH_CLASS) "." PATCH_STRING(PATCH_VARIANT)
+#else
+#define PATCH_NAMESPACE_(c) c##_host
+#define PATCH_NAMESPACE(c) PATCH_NAMESPACE_(c)
+#define PATCH_NAME PATCH_STRING(PATCH_CLASS)
+#endif
+
+namespace PATCH_NAMESPACE(PATCH_CLASS) {
+#include PATCH_HEADER
+}
+
+typedef PATCH_NAMESPACE(PATCH_CLASS)::PATCH_CLASS PatchClass;
+
+static Patch* createPatch(){
+  return new PatchClass();
+}
+
+// patches that define STATE_SIZE, getStateVariables and setStateVariables
+// register their filter memory, the others register none
+template<typename T> struct VoidType { typedef void type; };
+
+template<typename P, typename = void>
+struct PatchState {
+  static const int size = 0;
+  static PatchStateGetter getter(){ return NULL; }
+  static PatchStateSetter setter(){ return NULL; }
+};
+
+template<typename P>
+struct PatchState<P, typename VoidType<decltype(&P::getStateVariables)>::type> {
+  static const int size = P::STATE_SIZE;
+  static void get(Patch* patch, float* state){
+    static_cast<P*>(patch)->getStateVariables(state);
+  }
+  static void set(Patch* patch, const float* state){
+    static_cast<P*>(patch)->setStateVariables(state);
+  }
+  static PatchStateGetter getter(){ return get; }
+  static PatchStateSetter setter(){ return set; }
+};
+
+static PatchRegistration registration(PATCH_NAME, createPatch, sizeof(PatchClass),
+				      PatchState<PatchClass>::size,
+				      PatchState<PatchClass>::getter(),
+				      PatchState<PatchClass>::setter());
@@ -0,0 +1,272 @@
+/*
+ PatchFootprint: memory used by each patch, checked against a RAM budget.
+
+   PatchFootprint [options] [patch ...]
+
+ Reported per patch:
+   object     sizeof the patch class, including tables held as members
+   allocs     heap allocations made by the constructor, and
+   heap       the bytes they asked for (the object itself not counted)
+   ram        object + heap, what one instance costs
+   stack      high-water mark of processAudio: the stack of a dedicated
+              thread is painted, the patch is run, and the deepest
+              overwritten byte is found (minus the harness's own frames)
+   code       .text of the patch's host object file (x86/ARM differ, but
+   rodata     relative sizes carry over), initialisers included
+   data       .data and .bss of the same object file
+
+ A patch fails if ram or stack exceeds its budget; the exit status is
+ non-zero if any patch failed.
+*/
+
+#include <elf.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include "Benchmark.h"
+#include "RealtimeGuard.h"
+#include "SampleBuffer.h"
+
+struct SectionSizes {
+  size_t code;
+  size_t rodata;
+  size_t data;
+};
+
+static bool readSectionSizes(const char* path, SectionSizes& sizes){
+  memset(&sizes, 0, sizeof(sizes));
+  FILE* file = fopen(path, "rb");
+  if(file == NULL)
+    return false;
+  std::vector<char> bytes;
+  char chunk[4096];
+  size_t len;
+  while((len = fread(chunk, 1, sizeof(chunk), file)) > 0)
+    bytes.insert(bytes.end(), chunk, chunk+len);
+  fclose(file);
+  if(bytes.size() < sizeof(Elf64_Ehdr) || memcmp(&bytes[0], ELFMAG, SELFMAG) ||
+     bytes[EI_CLASS] != ELFCLASS64)
+    return false;
+  const Elf64_Ehdr* header = (const Elf64_Ehdr*)&bytes[0];
+  if(header->e_shoff + (size_t)header->e_shnum*sizeof(Elf64_Shdr) > bytes.size() ||
+     header->e_shstrndx >= header->e_shnum)
+    return false;
+  const Elf64_Shdr* sections = (const Elf64_Shdr*)&bytes[header->e_shoff];
+  const char* names = &bytes[sections[header->e_shstrndx].sh_offset];
+  for(int i=0; i<header->e_shnum; i++){
+    const Elf64_Shdr& section = sections[i];
+    const char* name = names + section.sh_name;
+    if(!(section.sh_flags & SHF_ALLOC))
+      continue;
+    if(section.sh_flags & SHF_EXECINSTR)
+      sizes.code += section.sh_size;
+    else if(strncmp(name, ".rodata", 7) == 0)
+      sizes.rodata += section.sh_size;
+    else if(strncmp(name, ".data", 5) == 0 || strncmp(name, ".bss", 4) == 0)
+      sizes.data += section.sh_size;
+  }
+  return true;
+}
+
+/* stack high-water mark */
+
+#define STACK_SIZE (256*1024)
+#define STACK_PAINT 0xa5
+
+class NullPatch : public Patch {
+public:
+  void processAudio(AudioBuffer&){}
+};
+
+static Patch* createNullPatch(){
+  return new NullPatch();
+}
+
+struct StackProbe {
+  PatchProcessor* processor;
+  AudioData* input;
+  ParameterSchedule* schedule;
+  unsigned char* stack;
+  size_t depth;
+};
+
+// paints the unused stack below the caller's frame and returns where it stopped
+__attribute__((noinline)) static unsigned char* paintStack(unsigned char* bottom){
+  unsigned char* top = (unsigned char*)__builtin_frame_address(0);
+  for(volatile unsigned char* p = bottom; p < top; p++)
+    *p = STACK_PAINT;
+  return top;
+}
+
+static void* measureStack(void* arg){
+  StackProbe* probe = (StackProbe*)arg;
+  PatchProcessor& processor = *probe->processor;
+  AudioData& input = *probe->input;
+  // once unpainted, so that lazy symbol binding does not show up as depth
+  runBenchmark(processor, input, 0, NULL, probe->schedule);
+  int blockSize = processor.getBlockSize();
+  SampleBuffer buffer(input.channels, blockSize);
+  std::vector<float*> in(input.channels);
+  for(int ch=0; ch<input.channels; ch++)
+    in[ch] = input.getChannel(ch);
+  // repaint for every block: only process() runs between paint and scan
+  for(int pos=0, block=0; pos<input.length; pos += blockSize, block++){
+    buffer.load(&in[0], pos, std::min(blockSize, input.length-pos));
+    probe->schedule->apply(processor, block);
+    unsigned char* top = paintStack(probe->stack);
+    processor.process(buffer);
+    unsigned char* p = probe->stack;
+    while(p < top && *p == STACK_PAINT)
+      p++;
+    probe->depth = std::max(probe->depth, (size_t)(top-p));
+  }
+  return NULL;
+}
+
+static size_t getStackDepth(PatchProcessor& processor, AudioData& input,
+			    ParameterSchedule& schedule){
+  StackProbe probe = { &processor, &input, &schedule, NULL, 0 };
+  void* stack = NULL;
+  if(posix_memalign(&stack, 4096, STACK_SIZE))
+    return 0;
+  probe.stack = (unsigned char*)stack;
+  pthread_attr_t attr;
+  pthread_attr_init(&attr);
+  pthread_attr_setstack(&attr, stack, STACK_SIZE);
+  pthread_t thread;
+  if(pthread_create(&thread, &attr, measureStack, &probe) == 0)
+    pthread_join(thread, NULL);
+  pthread_attr_destroy(&attr);
+  free(stack);
+  return probe.depth;
+}
+
+static void usage(const char* name){
+  fprintf(stderr,
+	  "usage: %s [options] [patch ...]\n"
+	  "  -m bytes    RAM budget per instance, object plus heap (default 65536)\n"
+	  "  -k bytes    stack budget for processAudio (default 4096)\n"
+	  "  -r rate     sample rate in Hz (default 48000)\n"
+	  "  -b size     block size in samples (default 128)\n"
+	  "  -c channels number of channels (default 2)\n"
+	  "  -d dir      directory holding the Patch_<name>.o objects (default: next to this tool)\n",
+	  name);
+}
+
+int main(int argc, char** argv){
+  size_t ramBudget = 65536;
+  size_t stackBudget = 4096;
+  double sampleRate = 48000;
+  int blockSize = 128;
+  int channels = 2;
+  std::string objects;
+  int opt;
+  while((opt = getopt(argc, argv, "m:k:r:b:c:d:h")) != -1){
+    switch(opt){
+    case 'm':
+      ramBudget = strtoul(optarg, NULL, 0);
+      break;
+    case 'k':
+      stackBudget = strtoul(optarg, NULL, 0);
+      break;
+    case 'r':
+      sampleRate = atof(optarg);
+      break;
+    case 'b':
+      blockSize = atoi(optarg);
+      break;
+    case 'c':
+      channels = atoi(optarg);
+      break;
+    case 'd':
+      objects = optarg;
+      break;
+    default:
+      usage(argv[0]);
+      return 1;
+    }
+  }
+  if(blockSize < 2 || channels < 1 || sampleRate <= 0){
+    usage(argv[0]);
+    return 1;
+  }
+  if(objects.empty()){
+    objects = argv[0];
+    size_t slash = objects.rfind('/');
+    objects = slash == std::string::npos ? "." : objects.substr(0, slash);
+  }
+  if(!RealtimeGuard::selfTest()){
+    fprintf(stderr, "allocation interposer is not active, heap figures would be meaningless\n");
+    return 2;
+  }
+
+  std::vector<const PatchDefinition*> patches;
+  for(int i=optind; i<argc; i++){
+    const PatchDefinition* def = PatchRegistry::getPatch(argv[i]);
+    if(def == NULL){
+      fprintf(stderr, "unknown patch: %s\n", argv[i]);
+      return 1;
+    }
+    patches.push_back(def);
+  }
+  if(patches.empty())
+    for(int i=0; i<PatchRegistry::getNumberOfPatches(); i++)
+      patches.push_back(PatchRegistry::getPatch(i));
+
+  // exercise every branch that could go deeper: random parameters, one second
+  AudioData input;
+  generateSignal("noise", input, channels, (int)sampleRate, sampleRate);
+  ParameterSchedule schedule;
+  schedule.generate("random", 1, (input.length+blockSize-1)/blockSize);
+
+  PatchDefinition null = { "NullPatch", createNullPatch, sizeof(NullPatch), 0, NULL, NULL };
+  PatchProcessor baseline(sampleRate, blockSize);
+  baseline.load(&null);
+  size_t harness = getStackDepth(baseline, input, schedule);
+
+  printf("budget: %zu bytes RAM, %zu bytes stack (harness frames %zu bytes excluded)\n",
+	 ramBudget, stackBudget, harness);
+  printf("%-32s %8s %6s %8s %8s %8s %8s %8s %8s  %s\n", "patch", "object", "allocs",
+	 "heap", "ram", "stack", "code", "rodata", "data", "status");
+  int failures = 0;
+  for(size_t i=0; i<patches.size(); i++){
+    const PatchDefinition* def = patches[i];
+    PatchProcessor processor(sampleRate, blockSize);
+    RealtimeGuard::reset();
+    RealtimeGuard::arm();
+    processor.load(def);
+    RealtimeGuard::disarm();
+    // load() news the patch object, everything else came from its constructor
+    int allocations = RealtimeGuard::getAllocations()-1;
+    size_t heap = RealtimeGuard::getAllocatedBytes()-def->size;
+
+    size_t depth = getStackDepth(processor, input, schedule);
+    depth = depth > harness ? depth-harness : 0;
+
+    SectionSizes sizes;
+    std::string path = objects + "/Patch_" + def->name + ".o";
+    bool haveSizes = readSectionSizes(path.c_str(), sizes);
+
+    size_t ram = def->size + heap;
+    std::string status;
+    if(ram > ramBudget)
+      status += "over RAM ";
+    if(depth > stackBudget)
+      status += "over stack ";
+    if(status.empty())
+      status = "ok";
+    else
+      failures++;
+    printf("%-32s %8zu %6d %8zu %8zu %8zu", def->name, def->size, allocations, heap, ram, depth);
+    if(haveSizes)
+      printf(" %8zu %8zu %8zu", sizes.code, sizes.rodata, sizes.data);
+    else
+      printf(" %8s %8s %8s", "n/a", "n/a", "n/a");
+    printf("  %s\n", status.c_str());
+  }
+  return failures ? 1 : 0;
+}
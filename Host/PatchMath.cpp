@@ -0,0 +1,210 @@
+/*
+ PatchMath: accuracy and speed of the approximations in ../FastMath.h
+ against libm, over the ranges the filter designs use them on.
+
+   PatchMath [options]
+
+ Each function is evaluated at -n points spread evenly over its range and
+ compared with the double precision libm result; libm's own float
+ function is measured the same way, for the rounding any float design
+ has anyway. Errors are given in ulp and in what they do to the design:
+   sin    SVF tuning f = sin(pi*fc/fs) (ThreeParallelBandPass), 20 Hz to
+          20 kHz: error of the cutoff it implies, in Hz
+   cos    biquad pole angle cos(2*pi*fc/fs), 20 Hz to 20 kHz: error of the
+          pole frequency, in Hz
+   pow10  the gains 10^(dB/20) and 10^(dB/40), -30 to 30 dB: error in dB
+   exp    the 50 Hz to 10 kHz knob mapping 50*e^x: error in Hz
+   log    log(high/low) of that mapping, 2 to 1000: error of the top
+          frequency, 10 kHz * error, in Hz
+   sincos sin and cos of the biquad angle from one call: the larger
+          absolute error of the two outputs, and ulp as for the others
+ Near 20 Hz a pole frequency moves by a fraction of a Hz per ulp of its
+ cosine, for libm as much as for the approximation.
+
+ Timing is the fastest of -k passes over the points, in ns per call, with
+ sin and cos of the same angle (as every design needs them) timed as
+ fastSinCos against sinf plus cosf.
+*/
+
+#include <stdio.h>
+#include <math.h>
+#include <unistd.h>
+#include <vector>
+#include "FastMath.h"
+#include "HostClock.h"
+
+#define LOW_HZ 20.0
+#define HIGH_HZ 20000.0
+
+struct MathError {
+  double unit; // largest error in the function's unit
+  double ulp;  // largest error in ulp of the float result
+};
+
+static double getUlp(double reference){
+  float f = fabsf((float)reference);
+  return nextafterf(f, INFINITY)-f;
+}
+
+// F: float function measured, R: double reference, U: error in units
+template<typename F, typename R, typename U>
+static MathError measure(const std::vector<float>& x, F f, R reference, U unit){
+  MathError error = { 0, 0 };
+  for(size_t i=0; i<x.size(); i++){
+    double ref = reference((double)x[i]);
+    double value = f(x[i]);
+    error.unit = fmax(error.unit, unit(x[i], value, ref));
+    error.ulp = fmax(error.ulp, fabs(value-ref)/getUlp(ref));
+  }
+  return error;
+}
+
+static MathError worst(MathError a, MathError b){
+  MathError error = { fmax(a.unit, b.unit), fmax(a.ulp, b.ulp) };
+  return error;
+}
+
+// fastest pass over the points, in ns per call
+template<typename F>
+static double timeCalls(const std::vector<float>& x, F f, int passes){
+  volatile float sink = 0;
+  uint64_t best = UINT64_MAX;
+  for(int p=0; p<passes; p++){
+    float sum = 0;
+    uint64_t start = getNanoseconds();
+    for(size_t i=0; i<x.size(); i++)
+      sum += f(x[i]);
+    uint64_t elapsed = getNanoseconds()-start;
+    sink = sink+sum;
+    if(elapsed < best)
+      best = elapsed;
+  }
+  return (double)best/x.size();
+}
+
+static std::vector<float> spread(double low, double high, int points){
+  std::vector<float> x(points);
+  for(int i=0; i<points; i++)
+    x[i] = low+(high-low)*i/(points-1);
+  return x;
+}
+
+static void printRow(const char* name, const char* range, const char* unit,
+		     MathError fast, MathError libm, double fastNs, double libmNs){
+  printf("%-7s %-22s %11.3g %-3s %5.1f %11.3g %-3s %5.1f %8.2f %8.2f %7.1fx\n",
+	 name, range, fast.unit, unit, fast.ulp, libm.unit, unit, libm.ulp,
+	 fastNs, libmNs, libmNs/fastNs);
+}
+
+static void usage(const char* name){
+  fprintf(stderr,
+	  "usage: %s [options]\n"
+	  "  -n points   points per function (default 1000000)\n"
+	  "  -k passes   timing passes, the fastest is used (default 5)\n"
+	  "  -r rate     sample rate in Hz (default 48000)\n",
+	  name);
+}
+
+int main(int argc, char** argv){
+  int points = 1000000;
+  int passes = 5;
+  double rate = 48000;
+  int opt;
+  while((opt = getopt(argc, argv, "n:k:r:h")) != -1){
+    switch(opt){
+    case 'n':
+      points = atoi(optarg);
+      break;
+    case 'k':
+      passes = atoi(optarg);
+      break;
+    case 'r':
+      rate = atof(optarg);
+      break;
+    default:
+      usage(argv[0]);
+      return 1;
+    }
+  }
+  if(optind != argc || points < 2 || passes < 1 || rate <= 2*HIGH_HZ){
+    usage(argv[0]);
+    return 1;
+  }
+
+  printf("FastMath.h against libm, %d points per function, %.0f Hz\n", points, rate);
+  printf("%-7s %-22s %15s %5s %15s %5s %8s %8s %8s\n", "", "range", "fast error", "ulp",
+	 "libm error", "ulp", "fast ns", "libm ns", "speedup");
+
+  // sin: SVF tuning angle pi*fc/fs
+  std::vector<float> x = spread(M_PI*LOW_HZ/rate, M_PI*HIGH_HZ/rate, points);
+  auto svfHz = [rate](float, double value, double ref){
+    return fabs(asin(fmin(value, 1.0))-asin(ref))*rate/M_PI;
+  };
+  auto refSin = [](double v){ return sin(v); };
+  auto sinCosFast = [](float v){ float s, c; fastSinCos(v, &s, &c); return s+c; };
+  auto sinCosLibm = [](float v){ return sinf(v)+cosf(v); };
+  printRow("sin", "pi*[20, 20k Hz]/fs", "Hz",
+	   measure(x, [](float v){ return fastSin(v); }, refSin, svfHz),
+	   measure(x, [](float v){ return sinf(v); }, refSin, svfHz),
+	   timeCalls(x, [](float v){ return fastSin(v); }, passes),
+	   timeCalls(x, [](float v){ return sinf(v); }, passes));
+
+  // cos: biquad angle 2*pi*fc/fs
+  x = spread(2*M_PI*LOW_HZ/rate, 2*M_PI*HIGH_HZ/rate, points);
+  auto poleHz = [rate](float, double value, double ref){
+    return fabs(acos(fmax(fmin(value, 1.0), -1.0))-acos(ref))*rate/(2*M_PI);
+  };
+  auto refCos = [](double v){ return cos(v); };
+  printRow("cos", "2pi*[20, 20k Hz]/fs", "Hz",
+	   measure(x, [](float v){ return fastCos(v); }, refCos, poleHz),
+	   measure(x, [](float v){ return cosf(v); }, refCos, poleHz),
+	   timeCalls(x, [](float v){ return fastCos(v); }, passes),
+	   timeCalls(x, [](float v){ return cosf(v); }, passes));
+  auto absolute = [](float, double value, double ref){
+    return fabs(value-ref);
+  };
+  auto sinOfFast = [](float v){ float s, c; fastSinCos(v, &s, &c); return s; };
+  auto cosOfFast = [](float v){ float s, c; fastSinCos(v, &s, &c); return c; };
+  printRow("sincos", "2pi*[20, 20k Hz]/fs", "",
+	   worst(measure(x, sinOfFast, refSin, absolute), measure(x, cosOfFast, refCos, absolute)),
+	   worst(measure(x, [](float v){ return sinf(v); }, refSin, absolute),
+		 measure(x, [](float v){ return cosf(v); }, refCos, absolute)),
+	   timeCalls(x, sinCosFast, passes), timeCalls(x, sinCosLibm, passes));
+
+  // pow10: dB/20 and dB/40 for -30 to 30 dB
+  x = spread(-1.5, 1.5, points);
+  auto gainDb = [](float, double value, double ref){
+    return fabs(20*log10(value/ref));
+  };
+  auto refPow10 = [](double v){ return pow(10.0, v); };
+  printRow("pow10", "[-30, 30] dB /20", "dB",
+	   measure(x, [](float v){ return fastPow10(v); }, refPow10, gainDb),
+	   measure(x, [](float v){ return powf(10, v); }, refPow10, gainDb),
+	   timeCalls(x, [](float v){ return fastPow10(v); }, passes),
+	   timeCalls(x, [](float v){ return powf(10, v); }, passes));
+
+  // exp: 50 Hz * e^x up to 10 kHz
+  x = spread(0, log(200.0), points);
+  auto mapHz = [](float, double value, double ref){
+    return 50*fabs(value-ref);
+  };
+  auto refExp = [](double v){ return exp(v); };
+  printRow("exp", "[0, log 200]", "Hz",
+	   measure(x, [](float v){ return fastExp(v); }, refExp, mapHz),
+	   measure(x, [](float v){ return expf(v); }, refExp, mapHz),
+	   timeCalls(x, [](float v){ return fastExp(v); }, passes),
+	   timeCalls(x, [](float v){ return expf(v); }, passes));
+
+  // log: the mapping's log(high/low), as the error of its 10 kHz end
+  x = spread(2, 1000, points);
+  auto topHz = [](float, double value, double ref){
+    return 10000*fabs(value-ref);
+  };
+  auto refLog = [](double v){ return log(v); };
+  printRow("log", "[2, 1000]", "Hz",
+	   measure(x, [](float v){ return fastLog(v); }, refLog, topHz),
+	   measure(x, [](float v){ return logf(v); }, refLog, topHz),
+	   timeCalls(x, [](float v){ return fastLog(v); }, passes),
+	   timeCalls(x, [](float v){ return logf(v); }, passes));
+  return 0;
+}
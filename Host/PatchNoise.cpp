@@ -0,0 +1,189 @@
+/*
+ PatchNoise: the noise floor and speed of a patch against a reference,
+ such as the Q31 variants of the EQ patches (../BiquadQ31.h) against
+ the float ones.
+
+   PatchNoise [options] reference patch ...
+
+ Every patch gets the same noise at 0, -40 and -80 dB below the test
+ signals' 0.5 peak, each followed by -t seconds of digital silence. The
+ report gives the cost per sample, then per level the RMS of the
+ difference from the reference's output in dB full scale and the
+ reference's output over it (SNR), and the peak of the last half of the
+ silent tails: a fixed-point filter that rounds its state can settle in
+ a limit cycle there instead of decaying.
+
+ The reference is float too, so a difference that falls with the level
+ is rounding of the float paths or of the coefficients, and one that
+ stays put is the fixed-point floor. At the EQ patches' default 0 dB
+ the bands cancel; give them some gain with -p.
+*/
+
+#include <stdio.h>
+#include <math.h>
+#include <unistd.h>
+#include <vector>
+#include "Benchmark.h"
+
+#define LEVELS 3
+static const float levels[LEVELS] = { 0.f, -40.f, -80.f }; // dB below the 0.5 peak
+
+struct NoiseRun {
+  double ns;                 // per sample, the best of the repeats at 0 dB
+  AudioData output[LEVELS];
+};
+
+static bool runPatch(const PatchDefinition* def, AudioData* inputs, int blockSize,
+		     int repeats, std::vector<const char*>& parameters, NoiseRun& run){
+  run.ns = 0;
+  for(int level=0; level<LEVELS; level++){
+    for(int r=0; r<(level == 0 ? repeats : 1); r++){
+      PatchProcessor processor(inputs[level].sampleRate, blockSize);
+      processor.load(def);
+      for(size_t p=0; p<parameters.size(); p++){
+	if(!processor.setParameter(parameters[p])){
+	  fprintf(stderr, "bad parameter: %s\n", parameters[p]);
+	  return false;
+	}
+      }
+      BenchmarkResult result = runBenchmark(processor, inputs[level], 0, &run.output[level]);
+      if(level == 0 && (r == 0 || result.getNsPerSample() < run.ns))
+	run.ns = result.getNsPerSample();
+    }
+  }
+  return true;
+}
+
+static double toDb(double x){
+  return x > 0 ? 20*log10(x) : -INFINITY;
+}
+
+static void usage(const char* name){
+  fprintf(stderr,
+	  "usage: %s [options] reference patch ...\n"
+	  "  -s seconds  noise per level (default 2)\n"
+	  "  -t seconds  silence after each level (default 1)\n"
+	  "  -r rate     sample rate in Hz (default 48000)\n"
+	  "  -b size     block size in samples (default 128)\n"
+	  "  -c channels number of channels (default 2)\n"
+	  "  -n repeats  timed runs per patch, the best is reported (default 3)\n"
+	  "  -p X=value  set parameter X (A to H) to value, 0.0 to 1.0 (default 0.5)\n",
+	  name);
+}
+
+int main(int argc, char** argv){
+  double noiseSeconds = 2;
+  double tailSeconds = 1;
+  double sampleRate = 48000;
+  int blockSize = 128;
+  int channels = 2;
+  int repeats = 3;
+  std::vector<const char*> parameters;
+  int opt;
+  while((opt = getopt(argc, argv, "s:t:r:b:c:n:p:h")) != -1){
+    switch(opt){
+    case 's':
+      noiseSeconds = atof(optarg);
+      break;
+    case 't':
+      tailSeconds = atof(optarg);
+      break;
+    case 'r':
+      sampleRate = atof(optarg);
+      break;
+    case 'b':
+      blockSize = atoi(optarg);
+      break;
+    case 'c':
+      channels = atoi(optarg);
+      break;
+    case 'n':
+      repeats = atoi(optarg);
+      break;
+    case 'p':
+      parameters.push_back(optarg);
+      break;
+    default:
+      usage(argv[0]);
+      return 1;
+    }
+  }
+  int noiseLength = (int)(noiseSeconds*sampleRate)/blockSize*blockSize;
+  int tailLength = (int)(tailSeconds*sampleRate)/blockSize*blockSize;
+  if(blockSize < 2 || channels < 1 || sampleRate <= 0 || repeats < 1 ||
+     noiseLength < blockSize || tailLength < 2*blockSize || argc-optind < 2){
+    usage(argv[0]);
+    return 1;
+  }
+
+  std::vector<const PatchDefinition*> patches;
+  for(int i=optind; i<argc; i++){
+    const PatchDefinition* def = PatchRegistry::getPatch(argv[i]);
+    if(def == NULL){
+      fprintf(stderr, "unknown patch: %s\n", argv[i]);
+      return 1;
+    }
+    patches.push_back(def);
+  }
+
+  AudioData inputs[LEVELS];
+  for(int level=0; level<LEVELS; level++){
+    generateSignal("noise", inputs[level], channels, noiseLength+tailLength, sampleRate);
+    float gain = powf(10, levels[level]/20);
+    for(int ch=0; ch<channels; ch++){
+      float* samples = inputs[level].getChannel(ch);
+      for(int i=0; i<noiseLength; i++)
+	samples[i] *= gain;
+      for(int i=noiseLength; i<noiseLength+tailLength; i++)
+	samples[i] = 0.f;
+    }
+  }
+
+  printf("%.1f s noise at 0, -40 and -80 dB, each then %.1f s silence, %d channels at "
+	 "%.0f Hz, block size %d\n", noiseLength/sampleRate, tailLength/sampleRate, channels,
+	 sampleRate, blockSize);
+  printf("%-32s %10s", "", "");
+  for(int level=0; level<LEVELS; level++){
+    char label[32];
+    snprintf(label, sizeof(label), "%.0f dB: error", levels[level]);
+    printf(" %14s %6s", label, "SNR");
+  }
+  printf(" %10s\n", "tail peak");
+  printf("%-32s %10s", "patch", "ns/sample");
+  for(int level=0; level<LEVELS; level++)
+    printf(" %14s %6s", "dBFS", "dB");
+  printf(" %10s\n", "dBFS");
+
+  NoiseRun reference;
+  if(!runPatch(patches[0], inputs, blockSize, repeats, parameters, reference))
+    return 1;
+  printf("%-32s %10.2f   (reference)\n", patches[0]->name, reference.ns);
+  for(size_t i=1; i<patches.size(); i++){
+    NoiseRun run;
+    if(!runPatch(patches[i], inputs, blockSize, repeats, parameters, run))
+      return 1;
+    printf("%-32s %10.2f", patches[i]->name, run.ns);
+    double tailPeak = 0;
+    for(int level=0; level<LEVELS; level++){
+      AudioData& ref = reference.output[level];
+      AudioData& out = run.output[level];
+      double signal = 0, error = 0;
+      for(int ch=0; ch<out.channels; ch++){
+	const float* r = ref.getChannel(ch);
+	const float* o = out.getChannel(ch);
+	for(int j=0; j<noiseLength; j++){
+	  signal += (double)r[j]*r[j];
+	  error += ((double)o[j]-r[j])*((double)o[j]-r[j]);
+	}
+	for(int j=noiseLength+tailLength/2; j<out.length; j++)
+	  tailPeak = fabs(o[j]) > tailPeak ? fabs(o[j]) : tailPeak;
+      }
+      long count = (long)out.channels*noiseLength;
+      signal = sqrt(signal/count);
+      error = sqrt(error/count);
+      printf(" %14.1f %6.1f", toDb(error), toDb(signal)-toDb(error));
+    }
+    printf(" %10.1f\n", toDb(tailPeak));
+  }
+  return 0;
+}
@@ -0,0 +1,104 @@
+#include "PatchProcessor.h"
+
+static thread_local PatchProcessor* initialising = NULL;
+
+PatchProcessor* PatchProcessor::getInitialisingProcessor(){
+  return initialising;
+}
+
+PatchProcessor::PatchProcessor(double sr, int bs)
+  : sampleRate(sr), blockSize(bs), patch(NULL), definition(NULL), flushDenormals(false) {
+  for(int i=0; i<NOF_PARAMETERS; i++){
+    parameterNames[i] = "";
+    parameterValues[i] = 0.5f;
+  }
+#ifdef BLOCK_LOAD_MONITOR
+  loadMonitor.setBudget(blockSize, sampleRate);
+#endif
+}
+
+PatchProcessor::~PatchProcessor(){
+  unload();
+}
+
+bool PatchProcessor::load(const char* name){
+  const PatchDefinition* def = PatchRegistry::getPatch(name);
+  if(def == NULL)
+    return false;
+  load(def);
+  return true;
+}
+
+void PatchProcessor::load(const PatchDefinition* def){
+  unload();
+  definition = def;
+  initialising = this;
+  patch = def->create();
+  initialising = NULL;
+}
+
+void PatchProcessor::unload(){
+  delete patch;
+  patch = NULL;
+  definition = NULL;
+  for(int i=0; i<NOF_PARAMETERS; i++)
+    parameterNames[i] = "";
+}
+
+void PatchProcessor::registerParameter(PatchParameterId pid, const char* name){
+  if(pid >= 0 && pid < NOF_PARAMETERS)
+    parameterNames[pid] = name;
+}
+
+const char* PatchProcessor::getParameterName(PatchParameterId pid) const {
+  if(pid >= 0 && pid < NOF_PARAMETERS)
+    return parameterNames[pid];
+  return "";
+}
+
+float PatchProcessor::getParameterValue(PatchParameterId pid) const {
+  if(pid >= 0 && pid < NOF_PARAMETERS)
+    return parameterValues[pid];
+  return 0.0f;
+}
+
+void PatchProcessor::setParameterValue(PatchParameterId pid, float value){
+  if(pid >= 0 && pid < NOF_PARAMETERS)
+    parameterValues[pid] = max(0.0f, min(1.0f, value));
+}
+
+bool PatchProcessor::setParameter(const char* assignment){
+  char letter = assignment[0];
+  if(letter >= 'a' && letter <= 'h')
+    letter -= 'a'-'A';
+  if(letter < 'A' || letter >= 'A'+NOF_PARAMETERS || assignment[1] != '=')
+    return false;
+  char* end;
+  float value = strtof(assignment+2, &end);
+  if(end == assignment+2 || *end != '\0')
+    return false;
+  setParameterValue((PatchParameterId)(letter-'A'), value);
+  return true;
+}
+
+/* Patch interface, as seen from inside a patch */
+
+Patch::Patch() : processor(PatchProcessor::getInitialisingProcessor()) {}
+
+Patch::~Patch(){}
+
+void Patch::registerParameter(PatchParameterId pid, const char* name, const char*){
+  processor->registerParameter(pid, name);
+}
+
+float Patch::getParameterValue(PatchParameterId pid){
+  return processor->getParameterValue(pid);
+}
+
+int Patch::getBlockSize(){
+  return processor->getBlockSize();
+}
+
+double Patch::getSampleRate(){
+  return processor->getSampleRate();
+}
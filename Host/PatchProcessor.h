@@ -0,0 +1,92 @@
+/*
+ Owns one patch instance together with the settings it reads through the
+ Patch interface: sample rate, block size and parameter values. Patches
+ bind to the processor that constructs them, so independent processors can
+ run side by side.
+*/
+
+#ifndef __PatchProcessor_h__
+#define __PatchProcessor_h__
+
+#include "StompBox.h"
+#include "PatchRegistry.h"
+#include "BlockLoadMonitor.h"
+#include "DenormalGuard.h"
+
+class PatchProcessor {
+private:
+  double sampleRate;
+  int blockSize;
+  Patch* patch;
+  const PatchDefinition* definition;
+  const char* parameterNames[NOF_PARAMETERS];
+  float parameterValues[NOF_PARAMETERS];
+  bool flushDenormals;
+#ifdef BLOCK_LOAD_MONITOR
+  BlockLoadMonitor loadMonitor;
+public:
+  BlockLoadMonitor& getLoadMonitor(){
+    return loadMonitor;
+  }
+#endif
+public:
+  PatchProcessor(double sampleRate, int blockSize);
+  ~PatchProcessor();
+
+  bool load(const char* name);
+  void load(const PatchDefinition* def);
+  void unload();
+
+  Patch* getPatch(){
+    return patch;
+  }
+  const char* getPatchName() const {
+    return definition ? definition->name : "";
+  }
+  double getSampleRate() const {
+    return sampleRate;
+  }
+  int getBlockSize() const {
+    return blockSize;
+  }
+
+  // the patch's filter memory, see PatchDefinition; 0 if it exposes none
+  int getStateSize() const {
+    return definition ? definition->stateSize : 0;
+  }
+  void getState(float* state){
+    definition->getState(patch, state);
+  }
+  void setState(const float* state){
+    definition->setState(patch, state);
+  }
+
+  void registerParameter(PatchParameterId pid, const char* name);
+  const char* getParameterName(PatchParameterId pid) const;
+  float getParameterValue(PatchParameterId pid) const;
+  void setParameterValue(PatchParameterId pid, float value);
+  // parse and apply an assignment such as "B=0.25"
+  bool setParameter(const char* assignment);
+
+  // processAudio runs with flush-to-zero when this is turned on, see
+  // ../DenormalGuard.h; off by default, so that the timing tools see
+  // the cost of subnormal tails as the pedal would
+  void setFlushDenormals(bool flush){
+    flushDenormals = flush;
+  }
+  bool getFlushDenormals() const {
+    return flushDenormals;
+  }
+
+  void process(AudioBuffer& buffer){
+    DenormalScope denormals(flushDenormals);
+    LOAD_MONITOR_BEGIN(loadMonitor);
+    patch->processAudio(buffer);
+    LOAD_MONITOR_END(loadMonitor);
+  }
+
+  // the processor whose load() is currently running on this thread
+  static PatchProcessor* getInitialisingProcessor();
+};
+
+#endif // __PatchProcessor_h__
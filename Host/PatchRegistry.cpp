@@ -0,0 +1,37 @@
+#include "PatchRegistry.h"
+#include <string.h>
+#include <vector>
+
+// function-local so that registration from other static initialisers is safe
+static std::vector<PatchDefinition>& definitions(){
+  static std::vector<PatchDefinition> defs;
+  return defs;
+}
+
+void PatchRegistry::registerPatch(const char* name, PatchCreator create, size_t size,
+				  int stateSize, PatchStateGetter getState, PatchStateSetter setState){
+  std::vector<PatchDefinition>& defs = definitions();
+  PatchDefinition def = { name, create, size, stateSize, getState, setState };
+  // keep the table sorted so listings do not depend on link order
+  std::vector<PatchDefinition>::iterator it = defs.begin();
+  while(it != defs.end() && strcmp(it->name, name) < 0)
+    ++it;
+  defs.insert(it, def);
+}
+
+int PatchRegistry::getNumberOfPatches(){
+  return definitions().size();
+}
+
+const PatchDefinition* PatchRegistry::getPatch(int index){
+  if(index < 0 || index >= getNumberOfPatches())
+    return NULL;
+  return &definitions()[index];
+}
+
+const PatchDefinition* PatchRegistry::getPatch(const char* name){
+  for(int i=0; i<getNumberOfPatches(); i++)
+    if(strcmp(definitions()[i].name, name) == 0)
+      return &definitions()[i];
+  return NULL;
+}
@@ -0,0 +1,45 @@
+/*
+ Table of the patches compiled into the host tools. Each patch is built in
+ its own translation unit (see PatchEntry.cpp) because several of them
+ define classes with the same name, and registers itself here.
+*/
+
+#ifndef __PatchRegistry_h__
+#define __PatchRegistry_h__
+
+#include <stddef.h>
+
+class Patch;
+
+typedef Patch* (*PatchCreator)();
+typedef void (*PatchStateGetter)(Patch* patch, float* state);
+typedef void (*PatchStateSetter)(Patch* patch, const float* state);
+
+struct PatchDefinition {
+  const char* name;
+  PatchCreator create;
+  size_t size; // sizeof the patch class
+  // filter memory, for patches that expose it: stateSize floats read and
+  // written by getState and setState, or 0 and NULL
+  int stateSize;
+  PatchStateGetter getState;
+  PatchStateSetter setState;
+};
+
+class PatchRegistry {
+public:
+  static void registerPatch(const char* name, PatchCreator create, size_t size,
+			    int stateSize, PatchStateGetter getState, PatchStateSetter setState);
+  static int getNumberOfPatches();
+  static const PatchDefinition* getPatch(int index);
+  static const PatchDefinition* getPatch(const char* name);
+};
+
+struct PatchRegistration {
+  PatchRegistration(const char* name, PatchCreator create, size_t size,
+		    int stateSize, PatchStateGetter getState, PatchStateSetter setState){
+    PatchRegistry::registerPatch(name, create, size, stateSize, getState, setState);
+  }
+};
+
+#endif // __PatchRegistry_h__
@@ -0,0 +1,461 @@
+/*
+ PatchRender: renders audio files through a patch, many files at once.
+
+   PatchRender [options] patch file ...
+
+ Inputs are WAV files (16, 24 or 32 bit PCM, or float) or raw interleaved
+ float32 (-c and -r give their shape). Each is memory mapped and streamed
+ through a fresh instance of the patch one block at a time, straight from
+ the mapping into the block buffer and from there into the mapped output,
+ a float WAV file named <name>.<patch>.wav next to the input or in -o.
+
+ Files are spread over a pool of worker threads, one per core by default.
+ Every worker owns a queue, filled largest file first; a worker whose
+ queue runs dry steals from the back of another's, so one long recording
+ does not leave the other cores idle at the end of a batch.
+
+ With -C a long file is split into chunks that render in parallel too.
+ Each chunk starts from silent filters a pre-roll (-P) ahead of its first
+ sample and throws that warm-up output away, so by the splice the filters
+ have forgotten the difference and the seam error is bounded by the decay
+ of the slowest filter over the pre-roll. That holds for time-invariant
+ patches only: one that runs a clock of absolute time (the LFO of
+ FormantFilterWithLFO, the trajectory of VowelFilterWithTraj) never
+ forgets where its chunk started, and its seams stay off by whatever that
+ clock does to the output, easily a tenth of full scale or more; the
+ splice and -V figures then measure that error, they do not bound it.
+ Both lengths are rounded to whole blocks so that chunks see the same
+ block grid, and so the same parameter updates, as a serial render. For
+ patches that expose their filter memory the report gives the largest
+ state mismatch at any splice: the distance between the state one chunk
+ ends in and the state the next one warmed up to. -V renders each file
+ serially once more and reports the largest sample error of the chunked
+ output, and that of a fresh instance restored from the serial state at
+ every chunk start (0 when the snapshot holds everything the patch
+ remembers).
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "HostClock.h"
+#include "MappedAudioFile.h"
+#include "PatchProcessor.h"
+#include "SampleBuffer.h"
+
+struct RenderJob {
+  const char* input;
+  std::string output;
+  off_t bytes;
+  long start, end; // frames of a chunk, end -1 for the whole file
+  double seconds;  // of audio rendered
+  uint64_t ns;
+  int worker;
+  bool ok;
+  std::vector<float> startState, endState; // filter memory at both ends of a chunk
+};
+
+struct RenderSettings {
+  const PatchDefinition* patch;
+  int blockSize;
+  int rawChannels;
+  double rawRate;
+  std::vector<const char*> parameters;
+  double chunkSeconds; // 0 renders files whole
+  double prerollSeconds;
+};
+
+class WorkQueue {
+private:
+  std::deque<int> jobs;
+  std::mutex lock;
+public:
+  void push(int job){
+    std::lock_guard<std::mutex> guard(lock);
+    jobs.push_back(job);
+  }
+  bool takeFront(int& job){
+    std::lock_guard<std::mutex> guard(lock);
+    if(jobs.empty())
+      return false;
+    job = jobs.front();
+    jobs.pop_front();
+    return true;
+  }
+  bool takeBack(int& job){
+    std::lock_guard<std::mutex> guard(lock);
+    if(jobs.empty())
+      return false;
+    job = jobs.back();
+    jobs.pop_back();
+    return true;
+  }
+};
+
+// seconds at the given rate as a whole number of blocks
+static long getBlockFrames(double seconds, double sampleRate, int blockSize){
+  return (long)(seconds*sampleRate/blockSize+0.5)*blockSize;
+}
+
+static void loadPatch(PatchProcessor& processor, const RenderSettings& settings){
+  processor.load(settings.patch);
+  for(size_t p=0; p<settings.parameters.size(); p++)
+    processor.setParameter(settings.parameters[p]);
+}
+
+static bool render(RenderJob& job, const RenderSettings& settings){
+  MappedAudioFile input;
+  if(!input.openRead(job.input, settings.rawChannels, settings.rawRate))
+    return false;
+  long frames = input.getFrames();
+  double sampleRate = input.getSampleRate();
+  MappedAudioFile output;
+  long end;
+  if(job.end < 0){
+    end = frames;
+    if(!output.openWrite(job.output.c_str(), input.getChannels(), frames, sampleRate))
+      return false;
+  }else{
+    // a chunk, into the output that main() sized for the whole file
+    end = min(job.end, frames);
+    if(!output.openUpdate(job.output.c_str()))
+      return false;
+  }
+  PatchProcessor processor(sampleRate, settings.blockSize);
+  loadPatch(processor, settings);
+  int stateSize = processor.getStateSize();
+  long preroll = getBlockFrames(settings.prerollSeconds, sampleRate, settings.blockSize);
+  // stereo patches read both channels, mono files feed the same to each
+  SampleBuffer buffer(max(2, input.getChannels()), settings.blockSize);
+  for(long offset=max(0L, job.start-preroll); offset<end; offset += settings.blockSize){
+    if(offset == job.start && stateSize){
+      job.startState.resize(stateSize);
+      processor.getState(&job.startState[0]);
+    }
+    input.read(buffer, offset);
+    processor.process(buffer);
+    if(offset >= job.start)
+      output.write(buffer, offset, min((long)settings.blockSize, end-offset));
+  }
+  if(stateSize){
+    job.endState.resize(stateSize);
+    processor.getState(&job.endState[0]);
+  }
+  job.seconds = (end-job.start)/sampleRate;
+  return true;
+}
+
+// renders the file serially and compares it with the chunked output:
+// 'error' is the largest sample difference, 'resumed' that of an instance
+// restored from the serial state at every chunk start, -1 without state
+static bool verify(const RenderJob& job, const RenderSettings& settings,
+		   float& error, float& resumed){
+  MappedAudioFile input, output;
+  if(!input.openRead(job.input, settings.rawChannels, settings.rawRate) ||
+     !output.openRead(job.output.c_str(), 0, 0))
+    return false;
+  long frames = input.getFrames();
+  double sampleRate = input.getSampleRate();
+  int blockSize = settings.blockSize;
+  long chunk = max((long)blockSize, getBlockFrames(settings.chunkSeconds, sampleRate, blockSize));
+  PatchProcessor serial(sampleRate, blockSize);
+  PatchProcessor resume(sampleRate, blockSize);
+  loadPatch(serial, settings);
+  int stateSize = serial.getStateSize();
+  std::vector<float> state(stateSize);
+  int channels = max(2, input.getChannels());
+  SampleBuffer expected(channels, blockSize);
+  SampleBuffer restored(channels, blockSize);
+  SampleBuffer chunked(channels, blockSize);
+  error = 0;
+  resumed = stateSize ? 0 : -1;
+  for(long offset=0; offset<frames; offset += blockSize){
+    if(stateSize && offset % chunk == 0){
+      serial.getState(&state[0]);
+      resume.unload();
+      loadPatch(resume, settings);
+      resume.setState(&state[0]);
+    }
+    input.read(expected, offset);
+    serial.process(expected);
+    if(stateSize){
+      input.read(restored, offset);
+      resume.process(restored);
+    }
+    output.read(chunked, offset);
+    int length = min((long)blockSize, frames-offset);
+    for(int ch=0; ch<output.getChannels(); ch++){
+      float* e = expected.getSamples(ch);
+      float* c = chunked.getSamples(ch);
+      float* r = restored.getSamples(ch);
+      for(int i=0; i<length; i++){
+	error = max(error, fabsf(c[i]-e[i]));
+	if(stateSize)
+	  resumed = max(resumed, fabsf(r[i]-e[i]));
+      }
+    }
+  }
+  return true;
+}
+
+static void work(int self, std::vector<WorkQueue>& queues, std::vector<RenderJob>& jobs,
+		 const RenderSettings& settings, int& steals){
+  int workers = queues.size();
+  for(;;){
+    int job;
+    bool found = queues[self].takeFront(job);
+    for(int i=1; !found && i<workers; i++)
+      if(queues[(self+i) % workers].takeBack(job)){
+	found = true;
+	steals++;
+      }
+    if(!found)
+      return;
+    uint64_t start = getNanoseconds();
+    jobs[job].ok = render(jobs[job], settings);
+    jobs[job].ns = getNanoseconds()-start;
+    jobs[job].worker = self;
+  }
+}
+
+static std::string getOutputPath(const char* input, const char* dir, const char* patch){
+  std::string path = input;
+  size_t slash = path.rfind('/');
+  std::string name = slash == std::string::npos ? path : path.substr(slash+1);
+  size_t dot = name.rfind('.');
+  if(dot != std::string::npos && dot > 0)
+    name = name.substr(0, dot);
+  std::string base = dir ? std::string(dir)+"/" :
+    slash == std::string::npos ? std::string() : path.substr(0, slash+1);
+  return base+name+"."+patch+".wav";
+}
+
+// one line for the chunks [first, last] of a file; false if any failed
+static bool reportChunks(std::vector<RenderJob>& jobs, size_t first, size_t last,
+			 const RenderSettings& settings, bool verifyChunks,
+			 double& seconds, double& cpu){
+  float splice = jobs[first].startState.empty() ? -1 : 0;
+  seconds = 0;
+  cpu = 0;
+  for(size_t k=first; k<=last; k++){
+    if(!jobs[k].ok)
+      return false;
+    seconds += jobs[k].seconds;
+    cpu += jobs[k].ns*1e-9;
+    for(size_t s=0; k>first && s<jobs[k].startState.size(); s++)
+      splice = max(splice, fabsf(jobs[k].startState[s]-jobs[k-1].endState[s]));
+  }
+  char buffer[32] = "-";
+  if(splice >= 0)
+    snprintf(buffer, sizeof(buffer), "%.3g", splice);
+  printf("%-40s %10.2f %10.1f %6d %12s", jobs[first].input, seconds, cpu*1e3,
+	 (int)(last-first+1), buffer);
+  if(verifyChunks){
+    float error, resumed;
+    if(!verify(jobs[first], settings, error, resumed)){
+      printf(" %12s\n", "failed");
+      return false;
+    }
+    strcpy(buffer, "-");
+    if(resumed >= 0)
+      snprintf(buffer, sizeof(buffer), "%.3g", resumed);
+    printf(" %12.3g %12s", error, buffer);
+  }
+  printf("\n");
+  return true;
+}
+
+static void usage(const char* name){
+  fprintf(stderr,
+	  "usage: %s [options] patch file ...\n"
+	  "  -j threads  worker threads (default one per core)\n"
+	  "  -o dir      directory for the rendered files (default next to each input)\n"
+	  "  -b size     block size in samples (default 128)\n"
+	  "  -p X=value  set parameter X (A to H) to value, 0.0 to 1.0 (default 0.5)\n"
+	  "  -c channels channels of raw float32 inputs (default 2)\n"
+	  "  -r rate     sample rate of raw float32 inputs (default 48000)\n"
+	  "  -C seconds  split files into chunks of this length, rendered in parallel\n"
+	  "  -P seconds  warm-up pre-roll rendered ahead of each chunk (default 0.5)\n"
+	  "  -V          render chunked files serially as well and report the error\n",
+	  name);
+}
+
+int main(int argc, char** argv){
+  int threads = std::thread::hardware_concurrency();
+  const char* outputDir = NULL;
+  RenderSettings settings;
+  settings.blockSize = 128;
+  settings.rawChannels = 2;
+  settings.rawRate = 48000;
+  settings.chunkSeconds = 0;
+  settings.prerollSeconds = 0.5;
+  bool verifyChunks = false;
+  int opt;
+  while((opt = getopt(argc, argv, "j:o:b:p:c:r:C:P:Vh")) != -1){
+    switch(opt){
+    case 'j':
+      threads = atoi(optarg);
+      break;
+    case 'o':
+      outputDir = optarg;
+      break;
+    case 'b':
+      settings.blockSize = atoi(optarg);
+      break;
+    case 'p':
+      settings.parameters.push_back(optarg);
+      break;
+    case 'c':
+      settings.rawChannels = atoi(optarg);
+      break;
+    case 'r':
+      settings.rawRate = atof(optarg);
+      break;
+    case 'C':
+      settings.chunkSeconds = atof(optarg);
+      break;
+    case 'P':
+      settings.prerollSeconds = atof(optarg);
+      break;
+    case 'V':
+      verifyChunks = true;
+      break;
+    default:
+      usage(argv[0]);
+      return 1;
+    }
+  }
+  if(argc-optind < 2 || settings.blockSize < 2 || settings.rawChannels < 1 ||
+     settings.rawRate <= 0 || settings.chunkSeconds < 0 || settings.prerollSeconds < 0){
+    usage(argv[0]);
+    return 1;
+  }
+  settings.patch = PatchRegistry::getPatch(argv[optind]);
+  if(settings.patch == NULL){
+    fprintf(stderr, "unknown patch: %s\n", argv[optind]);
+    return 1;
+  }
+  // check the assignments once here rather than in every worker
+  PatchProcessor check(settings.rawRate, settings.blockSize);
+  for(size_t p=0; p<settings.parameters.size(); p++){
+    if(!check.setParameter(settings.parameters[p])){
+      fprintf(stderr, "bad parameter: %s\n", settings.parameters[p]);
+      return 1;
+    }
+  }
+
+  int failures = 0;
+  std::vector<RenderJob> jobs;
+  for(int i=optind+1; i<argc; i++){
+    RenderJob job;
+    job.input = argv[i];
+    job.output = getOutputPath(argv[i], outputDir, settings.patch->name);
+    job.start = 0;
+    job.end = -1;
+    job.seconds = 0;
+    job.ns = 0;
+    job.worker = -1;
+    job.ok = false;
+    if(settings.chunkSeconds == 0){
+      struct stat info;
+      job.bytes = stat(argv[i], &info) == 0 ? info.st_size : 0;
+      jobs.push_back(job);
+      continue;
+    }
+    // the output is sized once here, its chunks are filled in place
+    MappedAudioFile input, output;
+    if(!input.openRead(job.input, settings.rawChannels, settings.rawRate) ||
+       !output.openWrite(job.output.c_str(), input.getChannels(), input.getFrames(),
+			 input.getSampleRate())){
+      fprintf(stderr, "cannot render %s to %s\n", job.input, job.output.c_str());
+      failures++;
+      continue;
+    }
+    long frames = input.getFrames();
+    long chunk = max((long)settings.blockSize,
+		     getBlockFrames(settings.chunkSeconds, input.getSampleRate(), settings.blockSize));
+    for(job.start=0; job.start<frames; job.start += chunk){
+      job.end = min(job.start+chunk, frames);
+      job.bytes = job.end-job.start;
+      jobs.push_back(job);
+    }
+  }
+  if(jobs.empty())
+    return 1;
+  threads = max(1, min(threads, (int)jobs.size()));
+
+  // largest first, dealt round robin, so that stealing only has the tail to even out
+  std::vector<int> order(jobs.size());
+  for(size_t i=0; i<jobs.size(); i++)
+    order[i] = i;
+  std::stable_sort(order.begin(), order.end(), [&](int a, int b){
+      return jobs[a].bytes > jobs[b].bytes;
+    });
+  std::vector<WorkQueue> queues(threads);
+  for(size_t i=0; i<order.size(); i++)
+    queues[i % threads].push(order[i]);
+
+  std::vector<int> steals(threads, 0);
+  std::vector<std::thread> workers;
+  uint64_t start = getNanoseconds();
+  for(int t=0; t<threads; t++)
+    workers.push_back(std::thread(work, t, std::ref(queues), std::ref(jobs),
+				  std::cref(settings), std::ref(steals[t])));
+  for(int t=0; t<threads; t++)
+    workers[t].join();
+  double wall = (getNanoseconds()-start)*1e-9;
+
+  int files = 0;
+  double audio = 0;
+  double cpu = 0;
+  int stolen = 0;
+  if(settings.chunkSeconds == 0)
+    printf("%-40s %10s %10s %10s %6s\n", "file", "seconds", "ms", "realtime", "worker");
+  else
+    printf("%-40s %10s %10s %6s %12s%s\n", "file", "seconds", "cpu ms", "chunks", "splice",
+	   verifyChunks ? "        error      resumed" : "");
+  for(size_t i=0; i<jobs.size(); i++){
+    RenderJob& job = jobs[i];
+    if(settings.chunkSeconds != 0){
+      // the chunks of a file are adjacent and in order
+      size_t last = i;
+      while(last+1 < jobs.size() && jobs[last+1].input == job.input)
+	last++;
+      double seconds, ns;
+      if(reportChunks(jobs, i, last, settings, verifyChunks, seconds, ns)){
+	audio += seconds;
+	cpu += ns;
+	files++;
+      }else{
+	fprintf(stderr, "cannot render %s to %s\n", job.input, job.output.c_str());
+	failures++;
+      }
+      i = last;
+      continue;
+    }
+    if(!job.ok){
+      fprintf(stderr, "cannot render %s to %s\n", job.input, job.output.c_str());
+      failures++;
+      continue;
+    }
+    printf("%-40s %10.2f %10.1f %9.1fx %6d\n", job.input, job.seconds, job.ns*1e-6,
+	   job.seconds/(job.ns*1e-9), job.worker);
+    audio += job.seconds;
+    cpu += job.ns*1e-9;
+    files++;
+  }
+  for(int t=0; t<threads; t++)
+    stolen += steals[t];
+  printf("%s: %d files, %.1f s of audio in %.2f s on %d threads (%.1fx realtime, %.1f%% busy), %d stolen\n",
+	 settings.patch->name, files, audio, wall, threads,
+	 audio/wall, 100*cpu/(wall*threads), stolen);
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,238 @@
+/*
+ PatchReplay: records and replays captures of the parameters and input a
+ patch was given (see PatchCapture.h).
+
+   PatchReplay -w capture [options] patch   record a host run
+   PatchReplay [options] capture            replay it
+
+ Recording drives the patch like PatchBench, with a parameter trajectory
+ from PatchStress's set, and writes every block to the capture as it is
+ processed. A capture written on the pedal has the same layout.
+
+ Replaying runs the captured patch block for block with the captured
+ parameter values, several times, and ranks the blocks by their fastest
+ time. The slowest blocks are listed with their parameter values, those
+ that changed on that block marked with '*', which is usually where a
+ model switch or a retrigger shows. Build with PROFILE_STAGES=1 for the
+ per-stage counters over the replay, or BLOCK_LOAD=1 for the load
+ histogram, or COEFFS_CACHE=1 for the share of filter designs the EQ
+ patches' coefficient caches skipped.
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <algorithm>
+#include <vector>
+#include "Benchmark.h"
+#include "CoeffsCacheStats.h"
+#include "PatchCapture.h"
+#include "ProfileStage.h"
+#include "SampleBuffer.h"
+
+static bool record(const char* path, const PatchDefinition* def, AudioData& input,
+		   ParameterSchedule& schedule, int blockSize, CaptureFormat format){
+  CaptureWriter writer;
+  if(!writer.open(path, def->name, input.sampleRate, blockSize, input.channels, format))
+    return false;
+  PatchProcessor processor(input.sampleRate, blockSize);
+  processor.load(def);
+  SampleBuffer buffer(input.channels, blockSize);
+  std::vector<float*> in(input.channels);
+  for(int ch=0; ch<input.channels; ch++)
+    in[ch] = input.getChannel(ch);
+  float parameters[NOF_PARAMETERS];
+  for(int pos=0, block=0; pos<input.length; pos += blockSize, block++){
+    buffer.load(&in[0], pos, min(blockSize, input.length-pos));
+    schedule.apply(processor, block);
+    for(int p=0; p<NOF_PARAMETERS; p++)
+      parameters[p] = processor.getParameterValue((PatchParameterId)p);
+    if(!writer.writeBlock(parameters, buffer))
+      return false;
+    processor.process(buffer);
+  }
+  return writer.close();
+}
+
+static void usage(const char* name){
+  fprintf(stderr,
+	  "usage: %s -w capture [options] patch\n"
+	  "       %s [options] capture\n"
+	  "recording:\n"
+	  "  -i input    noise, sine, sweep, impulse, silence, burst, or a .wav / raw float32 file (default noise)\n"
+	  "  -t name     parameter trajectory: static, sweep, jumps, random, jitter (default jitter)\n"
+	  "  -n seed     trajectory seed (default 1)\n"
+	  "  -s seconds  length of synthetic input (default 10)\n"
+	  "  -r rate     sample rate in Hz (default 48000)\n"
+	  "  -b size     block size in samples (default 128)\n"
+	  "  -c channels number of channels (default 2)\n"
+	  "  -q          store the audio as 16 bit instead of float\n"
+	  "replaying:\n"
+	  "  -k replays  replays, each block ranked by its fastest (default 5)\n"
+	  "  -N blocks   slowest blocks listed (default 10)\n"
+	  "  -o file     write the output of the first replay as a float WAV file\n",
+	  name, name);
+}
+
+int main(int argc, char** argv){
+  const char* capturePath = NULL;
+  const char* inputSpec = "noise";
+  const char* trajectory = "jitter";
+  uint32_t seed = 1;
+  double seconds = 10;
+  double sampleRate = 48000;
+  int blockSize = 128;
+  int channels = 2;
+  CaptureFormat format = CAPTURE_FLOAT32;
+  int replays = 5;
+  int listed = 10;
+  const char* outputPath = NULL;
+  int opt;
+  while((opt = getopt(argc, argv, "w:i:t:n:s:r:b:c:qk:N:o:h")) != -1){
+    switch(opt){
+    case 'w':
+      capturePath = optarg;
+      break;
+    case 'i':
+      inputSpec = optarg;
+      break;
+    case 't':
+      trajectory = optarg;
+      break;
+    case 'n':
+      seed = strtoul(optarg, NULL, 0);
+      break;
+    case 's':
+      seconds = atof(optarg);
+      break;
+    case 'r':
+      sampleRate = atof(optarg);
+      break;
+    case 'b':
+      blockSize = atoi(optarg);
+      break;
+    case 'c':
+      channels = atoi(optarg);
+      break;
+    case 'q':
+      format = CAPTURE_INT16;
+      break;
+    case 'k':
+      replays = max(1, atoi(optarg));
+      break;
+    case 'N':
+      listed = atoi(optarg);
+      break;
+    case 'o':
+      outputPath = optarg;
+      break;
+    default:
+      usage(argv[0]);
+      return 1;
+    }
+  }
+  if(optind != argc-1 || blockSize < 2 || channels < 1 || sampleRate <= 0){
+    usage(argv[0]);
+    return 1;
+  }
+
+  if(capturePath){
+    const PatchDefinition* def = PatchRegistry::getPatch(argv[optind]);
+    if(def == NULL){
+      fprintf(stderr, "unknown patch: %s\n", argv[optind]);
+      return 1;
+    }
+    if(!ParameterSchedule::isTrajectoryName(trajectory)){
+      fprintf(stderr, "unknown trajectory: %s\n", trajectory);
+      return 1;
+    }
+    AudioData input;
+    if(!loadInput(inputSpec, input, channels, (int)(seconds*sampleRate), sampleRate)){
+      fprintf(stderr, "cannot read input: %s\n", inputSpec);
+      return 1;
+    }
+    ParameterSchedule schedule;
+    schedule.generate(trajectory, seed, (input.length+blockSize-1)/blockSize);
+    if(!record(capturePath, def, input, schedule, blockSize, format)){
+      fprintf(stderr, "cannot write capture: %s\n", capturePath);
+      return 1;
+    }
+    printf("%s: %d blocks of %s with %s parameters (seed %u) captured to %s\n",
+	   def->name, schedule.getBlocks(), inputSpec, trajectory, seed, capturePath);
+    return 0;
+  }
+
+  CaptureHeader header;
+  AudioData input;
+  ParameterSchedule schedule;
+  if(!readCapture(argv[optind], header, input, schedule)){
+    fprintf(stderr, "cannot read capture: %s\n", argv[optind]);
+    return 1;
+  }
+  const PatchDefinition* def = PatchRegistry::getPatch(header.patch);
+  if(def == NULL){
+    fprintf(stderr, "capture is of an unknown patch: %s\n", header.patch);
+    return 1;
+  }
+  int blocks = schedule.getBlocks();
+  double budget = BenchmarkResult::getBudgetNs(header.blockSize, header.sampleRate);
+  printf("%s: %d blocks of %d, %d channels at %.0f Hz (%s), budget %.1f us\n",
+	 def->name, blocks, header.blockSize, header.channels, header.sampleRate,
+	 header.format == CAPTURE_INT16 ? "16 bit" : "float", budget*1e-3);
+
+#ifdef PROFILE_STAGES
+  if(!StageProfiler::open())
+    fprintf(stderr, "no hardware counters (%s), timing stages with the cycle counter only\n",
+	    StageProfiler::getError());
+#endif
+  // every replay starts from a fresh instance, as the capture did
+  std::vector<uint64_t> fastest(blocks, UINT64_MAX);
+  std::vector<uint64_t> times;
+  AudioData output;
+  for(int r=0; r<replays; r++){
+    PatchProcessor processor(header.sampleRate, header.blockSize);
+    processor.load(def);
+    runBenchmark(processor, input, 0, r == 0 ? &output : NULL, &schedule, &times);
+    for(int b=0; b<blocks; b++)
+      fastest[b] = min(fastest[b], times[b]);
+#ifdef BLOCK_LOAD_MONITOR
+    if(r == replays-1){
+      BlockLoadMonitor::printHeader(stdout);
+      processor.getLoadMonitor().print(stdout, def->name);
+    }
+#endif
+  }
+  if(outputPath && !writeWavFile(outputPath, output)){
+    fprintf(stderr, "cannot write %s\n", outputPath);
+    return 1;
+  }
+
+  std::vector<int> order(blocks);
+  for(int b=0; b<blocks; b++)
+    order[b] = b;
+  std::sort(order.begin(), order.end(), [&](int a, int b){
+      return fastest[a] > fastest[b];
+    });
+  std::vector<uint64_t> sorted(fastest);
+  std::sort(sorted.begin(), sorted.end());
+  if(CoeffsCacheStats::getHitRate() >= 0)
+    printf("coefficient cache: %.1f%% of %llu filter designs skipped per replay\n",
+	   CoeffsCacheStats::getHitRate(), (unsigned long long)CoeffsCacheStats::getLookups());
+  printf("median block %.2f us over %d replays; slowest blocks:\n",
+	 sorted[blocks/2]*1e-3, replays);
+  printf("%8s %10s %8s  %s\n", "block", "us", "load", "parameters A..H, * changed");
+  for(int i=0; i<listed && i<blocks; i++){
+    int b = order[i];
+    printf("%8d %10.2f %7.1f%% ", b, fastest[b]*1e-3, 100*fastest[b]/budget);
+    for(int p=0; p<NOF_PARAMETERS; p++){
+      PatchParameterId pid = (PatchParameterId)p;
+      bool changed = b > 0 && schedule.getValue(b, pid) != schedule.getValue(b-1, pid);
+      printf(" %.3f%c", schedule.getValue(b, pid), changed ? '*' : ' ');
+    }
+    printf("\n");
+  }
+#ifdef PROFILE_STAGES
+  StageProfiler::print(stdout);
+#endif
+  return 0;
+}
@@ -0,0 +1,387 @@
+/*
+ PatchResponse: measures the linear response of a patch with an
+ exponential sine sweep, for any number of parameter settings.
+
+   PatchResponse [options] patch
+   PatchResponse -C [options]      check the calibration
+
+ Every input channel gets the same 20 Hz to 20 kHz sweep, after a short
+ silence and followed by a tail. The recorded output is deconvolved by
+ spectral division with the sweep, which gives the impulse response;
+ magnitude, phase and group delay come from the transform of that
+ impulse response. The division is regularised outside the sweep's band
+ only, and at about the float transform's rounding level, so that the
+ band itself is measured without bias. Harmonic distortion lands at
+ negative times, i.e. at the end of the deconvolved signal, and is cut
+ off with everything past the impulse response length.
+
+ Parameters are fixed for a whole measurement. Settings are the cartesian
+ product of the -g grids, each on top of the -p values, so
+ '-g A=5 -g B=5' measures 25 settings. Patches that modulate themselves
+ (LFOs, trajectories) are time-variant and only measured approximately.
+
+ -C measures GainPatch at unity gain instead, which must read 0.00 dB
+ at every octave and give a single unit tap, and fails otherwise.
+
+ One line per setting gives the magnitude at octave centres and the
+ largest peak. With -o each setting also writes <patch>.<n>.ir.wav and
+ <patch>.<n>.txt: frequency, magnitude dB, phase degrees and group delay ms
+ at 1/12 octave steps.
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+#include "Benchmark.h"
+#include "FastFourierTransform.h"
+
+#define SWEEP_LOW 20.0
+#define SWEEP_HIGH 20000.0
+#define PRE_SECONDS 0.25
+#define TAIL_SECONDS 0.5
+#define REGULARISATION 1e-14 // of the sweep's peak power
+#define IDENTITY_TOLERANCE 1e-6 // of the unit tap, for -C
+
+static const double octaves[] = { 31.5, 63, 125, 250, 500, 1000, 2000, 4000, 8000, 16000 };
+static const int nofOctaves = sizeof(octaves)/sizeof(octaves[0]);
+
+struct GridAxis {
+  char parameter;
+  int steps;
+};
+
+class SweepAnalyser {
+private:
+  int size;
+  int recordLength;
+  int irLength;
+  double sampleRate;
+  FastFourierTransform fft;
+  FastFourierTransform irFft;
+  ComplexFloatArray sweepSpectrum;
+  ComplexFloatArray spectrum;
+  FloatArray ir;
+  ComplexFloatArray response;
+  ComplexFloatArray weighted; // transform of n*ir[n], for group delay
+  ComplexFloatArray scratch;
+public:
+  SweepAnalyser(AudioData& sweep, int recordLen, int irLen);
+  ~SweepAnalyser();
+  void analyse(float* recorded);
+  FloatArray getImpulseResponse(){
+    return ir;
+  }
+  double getMagnitude(double freq);
+  double getPhase(double freq);
+  double getGroupDelay(double freq);
+  double getPeak(double& freq);
+private:
+  int getBin(double freq){
+    int bin = (int)(freq*irLength/sampleRate+0.5);
+    return bin < irLength/2 ? bin : irLength/2;
+  }
+};
+
+SweepAnalyser::SweepAnalyser(AudioData& sweep, int recordLen, int irLen)
+  : recordLength(recordLen), irLength(irLen), sampleRate(sweep.sampleRate) {
+  size = 1;
+  while(size < recordLength)
+    size *= 2;
+  fft.init(size);
+  irFft.init(irLength);
+  sweepSpectrum = ComplexFloatArray::create(size);
+  spectrum = ComplexFloatArray::create(size);
+  ir = FloatArray::create(size);
+  response = ComplexFloatArray::create(irLength);
+  weighted = ComplexFloatArray::create(irLength);
+  scratch = ComplexFloatArray::create(irLength);
+  FloatArray padded = FloatArray::create(size);
+  padded.clear();
+  padded.copyFrom(sweep.getChannel(0), sweep.length);
+  fft.fft(padded, sweepSpectrum);
+  FloatArray::destroy(padded);
+}
+
+SweepAnalyser::~SweepAnalyser(){
+  ComplexFloatArray::destroy(sweepSpectrum);
+  ComplexFloatArray::destroy(spectrum);
+  FloatArray::destroy(ir);
+  ComplexFloatArray::destroy(response);
+  ComplexFloatArray::destroy(weighted);
+  ComplexFloatArray::destroy(scratch);
+}
+
+// 'recorded' holds the output from the start of the sweep, recordLength samples
+void SweepAnalyser::analyse(float* recorded){
+  ir.clear();
+  ir.copyFrom(recorded, recordLength);
+  fft.fft(ir, spectrum);
+  double peak = 0;
+  for(int i=0; i<size; i++)
+    peak = fmax(peak, sweepSpectrum[i].re*sweepSpectrum[i].re + sweepSpectrum[i].im*sweepSpectrum[i].im);
+  double floor = REGULARISATION*peak;
+  int low = (int)(SWEEP_LOW*size/sampleRate);
+  int high = (int)(fmin(SWEEP_HIGH, sampleRate*0.45)*size/sampleRate+1);
+  for(int i=0; i<size; i++){
+    // Y conj(X) / (|X|^2 + floor), with the floor outside the sweep's band
+    ComplexFloat x = sweepSpectrum[i];
+    ComplexFloat y = spectrum[i];
+    int bin = i <= size/2 ? i : size-i;
+    double power = x.re*x.re + x.im*x.im;
+    if(bin < low || bin > high)
+      power += floor;
+    spectrum[i].re = (y.re*x.re + y.im*x.im)/power;
+    spectrum[i].im = (y.im*x.re - y.re*x.im)/power;
+  }
+  fft.ifft(spectrum, ir);
+  // fade the end of the kept part out over its last eighth
+  int fade = irLength/8;
+  for(int i=0; i<fade; i++)
+    ir[irLength-fade+i] *= 0.5f*(1+cosf(M_PI*i/fade));
+  FloatArray head(ir, irLength);
+  irFft.fft(head, response);
+  for(int i=0; i<irLength; i++){
+    scratch[i].re = i*ir[i];
+    scratch[i].im = 0;
+  }
+  irFft.fft(scratch, weighted);
+}
+
+double SweepAnalyser::getMagnitude(double freq){
+  return 20*log10(fmax(response[getBin(freq)].getMagnitude(), 1e-10));
+}
+
+double SweepAnalyser::getPhase(double freq){
+  return response[getBin(freq)].getPhase()*180/M_PI;
+}
+
+// Re(FFT(n h[n]) / FFT(h[n])), in milliseconds
+double SweepAnalyser::getGroupDelay(double freq){
+  ComplexFloat h = response[getBin(freq)];
+  ComplexFloat n = weighted[getBin(freq)];
+  double power = h.re*h.re + h.im*h.im;
+  if(power < 1e-20)
+    return 0;
+  return 1e3*(n.re*h.re + n.im*h.im)/power/sampleRate;
+}
+
+// the sweep's spectrum ripples near its ends, so search a sixth of an octave in from them
+double SweepAnalyser::getPeak(double& freq){
+  double edge = pow(2, 1.0/6);
+  double high = fmin(SWEEP_HIGH, sampleRate*0.45);
+  double best = 0;
+  freq = 0;
+  for(int bin=getBin(SWEEP_LOW*edge); bin<=getBin(high/edge); bin++){
+    double magnitude = response[bin].getMagnitude();
+    if(magnitude > best){
+      best = magnitude;
+      freq = bin*sampleRate/irLength;
+    }
+  }
+  return 20*log10(fmax(best, 1e-10));
+}
+
+static bool writeResponse(const char* path, const char* setting, SweepAnalyser& analyser,
+			  double sampleRate){
+  FILE* file = fopen(path, "w");
+  if(file == NULL)
+    return false;
+  fprintf(file, "# %s\n# Hz dB degrees ms\n", setting);
+  double high = fmin(SWEEP_HIGH, sampleRate*0.45);
+  for(double freq=SWEEP_LOW; freq<=high; freq *= pow(2, 1.0/12))
+    fprintf(file, "%.1f %.3f %.2f %.4f\n", freq, analyser.getMagnitude(freq),
+	    analyser.getPhase(freq), analyser.getGroupDelay(freq));
+  return fclose(file) == 0;
+}
+
+// GainPatch at unity gain: 0 dB in the band and a single unit tap
+static bool checkIdentity(SweepAnalyser& analyser, AudioData& input, int pre, int channel,
+			  int blockSize){
+  PatchProcessor processor(input.sampleRate, blockSize);
+  if(!processor.load("GainPatch"))
+    return false;
+  processor.setParameter("A=1");
+  processor.setParameter("B=0.5");
+  AudioData output;
+  runBenchmark(processor, input, 0, &output);
+  analyser.analyse(output.getChannel(channel)+pre);
+  FloatArray ir = analyser.getImpulseResponse();
+  double tap = fabs(ir[0]-1);
+  double rest = 0;
+  for(int i=1; i<(int)ir.getSize(); i++)
+    rest = fmax(rest, fabs(ir[i]));
+  double worst = 0;
+  for(int i=0; i<nofOctaves; i++)
+    if(octaves[i] < input.sampleRate*0.45)
+      worst = fmax(worst, fabs(analyser.getMagnitude(octaves[i])));
+  double freq;
+  worst = fmax(worst, fabs(analyser.getPeak(freq)));
+  bool ok = worst < 0.005 && tap < IDENTITY_TOLERANCE && rest < IDENTITY_TOLERANCE;
+  printf("identity: largest deviation %.4f dB, unit tap off by %.2g, largest other tap %.2g: %s\n",
+	 worst, tap, rest, ok ? "ok" : "FAILED");
+  return ok;
+}
+
+static void usage(const char* name){
+  fprintf(stderr,
+	  "usage: %s [options] patch\n"
+	  "  -C          check the calibration on GainPatch at unity gain instead\n"
+	  "  -g X=steps  measure parameter X (A to H) at 'steps' values from 0.0 to 1.0\n"
+	  "  -p X=value  set parameter X for every setting (default 0.5)\n"
+	  "  -s seconds  sweep length (default 2)\n"
+	  "  -L samples  impulse response length, a power of two (default 8192)\n"
+	  "  -c channel  output channel to measure (default 0)\n"
+	  "  -o dir      write the impulse response and full response of each setting\n"
+	  "  -r rate     sample rate in Hz (default 48000)\n"
+	  "  -b size     block size in samples (default 128)\n",
+	  name);
+}
+
+int main(int argc, char** argv){
+  double seconds = 2;
+  int irLength = 8192;
+  int channel = 0;
+  const char* outputDir = NULL;
+  double sampleRate = 48000;
+  int blockSize = 128;
+  std::vector<const char*> parameters;
+  std::vector<GridAxis> grid;
+  bool calibrate = false;
+  int opt;
+  while((opt = getopt(argc, argv, "Cg:p:s:L:c:o:r:b:h")) != -1){
+    switch(opt){
+    case 'C':
+      calibrate = true;
+      break;
+    case 'g': {
+      GridAxis axis = { optarg[0], 0 };
+      if(axis.parameter < 'A' || axis.parameter > 'H' || optarg[1] != '=' ||
+	 (axis.steps = atoi(optarg+2)) < 1){
+	fprintf(stderr, "bad grid: %s\n", optarg);
+	return 1;
+      }
+      grid.push_back(axis);
+      break;
+    }
+    case 'p':
+      parameters.push_back(optarg);
+      break;
+    case 's':
+      seconds = atof(optarg);
+      break;
+    case 'L':
+      irLength = atoi(optarg);
+      break;
+    case 'c':
+      channel = atoi(optarg);
+      break;
+    case 'o':
+      outputDir = optarg;
+      break;
+    case 'r':
+      sampleRate = atof(optarg);
+      break;
+    case 'b':
+      blockSize = atoi(optarg);
+      break;
+    default:
+      usage(argv[0]);
+      return 1;
+    }
+  }
+  if(optind != argc-(calibrate ? 0 : 1) || blockSize < 2 || sampleRate <= 0 || seconds <= 0 ||
+     irLength < 16 || (irLength & (irLength-1)) || channel < 0){
+    usage(argv[0]);
+    return 1;
+  }
+  const PatchDefinition* def = calibrate ? NULL : PatchRegistry::getPatch(argv[optind]);
+  if(def == NULL && !calibrate){
+    fprintf(stderr, "unknown patch: %s\n", argv[optind]);
+    return 1;
+  }
+
+  int channels = max(2, channel+1);
+  int pre = (int)(PRE_SECONDS*sampleRate);
+  int recordLength = (int)((seconds+TAIL_SECONDS)*sampleRate);
+  if(irLength > recordLength){
+    fprintf(stderr, "impulse response longer than the recording\n");
+    return 1;
+  }
+  AudioData sweep;
+  generateSignal("sweep", sweep, 1, (int)(seconds*sampleRate), sampleRate);
+  AudioData input;
+  input.allocate(channels, pre+recordLength);
+  input.sampleRate = sampleRate;
+  for(int ch=0; ch<channels; ch++)
+    memcpy(input.getChannel(ch)+pre, sweep.getChannel(0), sweep.length*sizeof(float));
+  SweepAnalyser analyser(sweep, recordLength, irLength);
+  if(calibrate)
+    return checkIdentity(analyser, input, pre, channel, blockSize) ? 0 : 1;
+
+  int settings = 1;
+  for(size_t i=0; i<grid.size(); i++)
+    settings *= grid[i].steps;
+  printf("%s: %d settings, %.1f s sweep, %d sample impulse response, channel %d\n",
+	 def->name, settings, seconds, irLength, channel);
+  printf("%4s  %-32s", "n", "setting");
+  for(int i=0; i<nofOctaves; i++)
+    if(octaves[i] < sampleRate*0.45)
+      printf(" %6.0f", octaves[i]);
+  printf(" %10s %8s\n", "peak Hz", "peak dB");
+
+  for(int n=0; n<settings; n++){
+    PatchProcessor processor(sampleRate, blockSize);
+    processor.load(def);
+    for(size_t p=0; p<parameters.size(); p++){
+      if(!processor.setParameter(parameters[p])){
+	fprintf(stderr, "bad parameter: %s\n", parameters[p]);
+	return 1;
+      }
+    }
+    std::string setting;
+    for(int i=0, index=n; i<(int)grid.size(); i++){
+      int step = index % grid[i].steps;
+      index /= grid[i].steps;
+      char assignment[16];
+      snprintf(assignment, sizeof(assignment), "%c=%.3f", grid[i].parameter,
+	       grid[i].steps > 1 ? (double)step/(grid[i].steps-1) : 0.5);
+      processor.setParameter(assignment);
+      setting += std::string(setting.empty() ? "" : " ")+assignment;
+    }
+    if(setting.empty())
+      setting = "fixed";
+
+    AudioData output;
+    runBenchmark(processor, input, 0, &output);
+    analyser.analyse(output.getChannel(channel)+pre);
+
+    printf("%4d  %-32s", n, setting.c_str());
+    for(int i=0; i<nofOctaves; i++)
+      if(octaves[i] < sampleRate*0.45)
+	printf(" %6.1f", analyser.getMagnitude(octaves[i]));
+    double peakFreq;
+    double peak = analyser.getPeak(peakFreq);
+    printf(" %10.1f %8.2f\n", peakFreq, peak);
+
+    if(outputDir){
+      char path[512];
+      snprintf(path, sizeof(path), "%s/%s.%d.txt", outputDir, def->name, n);
+      if(!writeResponse(path, setting.c_str(), analyser, sampleRate)){
+	fprintf(stderr, "cannot write %s\n", path);
+	return 1;
+      }
+      AudioData impulse;
+      impulse.allocate(1, irLength);
+      impulse.sampleRate = sampleRate;
+      memcpy(impulse.getChannel(0), analyser.getImpulseResponse().getData(), irLength*sizeof(float));
+      snprintf(path, sizeof(path), "%s/%s.%d.ir.wav", outputDir, def->name, n);
+      if(!writeWavFile(path, impulse)){
+	fprintf(stderr, "cannot write %s\n", path);
+	return 1;
+      }
+    }
+  }
+  return 0;
+}
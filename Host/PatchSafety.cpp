@@ -0,0 +1,137 @@
+/*
+ PatchSafety: fails any patch whose processAudio allocates, locks, sleeps
+ or does I/O.
+
+   PatchSafety [options] [patch ...]
+
+ Each patch is constructed normally (allocating in the constructor is
+ fine) and then run with the RealtimeGuard armed around every call to
+ processAudio, under every parameter trajectory and input, so that rarely
+ taken branches such as a model switch are exercised too. Offending calls
+ are reported with their stacks; the exit status is non-zero if any patch
+ failed.
+*/
+
+#include <stdio.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+#include "AudioData.h"
+#include "ParameterSchedule.h"
+#include "PatchProcessor.h"
+#include "RealtimeGuard.h"
+#include "SampleBuffer.h"
+
+static void usage(const char* name){
+  fprintf(stderr,
+	  "usage: %s [options] [patch ...]\n"
+	  "  -s seconds  length of each run (default 1)\n"
+	  "  -r rate     sample rate in Hz (default 48000)\n"
+	  "  -b size     block size in samples (default 128)\n"
+	  "  -c channels number of channels (default 2)\n"
+	  "  -v stacks   stacks to print per failing patch (default 4)\n",
+	  name);
+}
+
+// returns the block of the first violation, or -1
+static int run(const PatchDefinition* def, const char* trajectory, const char* signal,
+	       double seconds, double sampleRate, int blockSize, int channels){
+  AudioData input;
+  generateSignal(signal, input, channels, (int)(seconds*sampleRate), sampleRate);
+  PatchProcessor processor(sampleRate, blockSize);
+  processor.load(def);
+  int blocks = (input.length+blockSize-1)/blockSize;
+  ParameterSchedule schedule;
+  schedule.generate(trajectory, 1, blocks);
+  SampleBuffer buffer(channels, blockSize);
+  std::vector<float*> in(channels);
+  for(int ch=0; ch<channels; ch++)
+    in[ch] = input.getChannel(ch);
+  for(int block=0; block<blocks; block++){
+    int pos = block*blockSize;
+    buffer.load(&in[0], pos, min(blockSize, input.length-pos));
+    schedule.apply(processor, block);
+    RealtimeGuard::arm();
+    processor.process(buffer);
+    RealtimeGuard::disarm();
+    if(RealtimeGuard::getViolations())
+      return block;
+  }
+  return -1;
+}
+
+int main(int argc, char** argv){
+  double seconds = 1;
+  double sampleRate = 48000;
+  int blockSize = 128;
+  int channels = 2;
+  int stacks = 4;
+  int opt;
+  while((opt = getopt(argc, argv, "s:r:b:c:v:h")) != -1){
+    switch(opt){
+    case 's':
+      seconds = atof(optarg);
+      break;
+    case 'r':
+      sampleRate = atof(optarg);
+      break;
+    case 'b':
+      blockSize = atoi(optarg);
+      break;
+    case 'c':
+      channels = atoi(optarg);
+      break;
+    case 'v':
+      stacks = atoi(optarg);
+      break;
+    default:
+      usage(argv[0]);
+      return 1;
+    }
+  }
+  if(blockSize < 2 || channels < 1 || sampleRate <= 0){
+    usage(argv[0]);
+    return 1;
+  }
+  if(!RealtimeGuard::selfTest()){
+    fprintf(stderr, "allocation interposer is not active, results would be meaningless\n");
+    return 2;
+  }
+
+  std::vector<const PatchDefinition*> patches;
+  for(int i=optind; i<argc; i++){
+    const PatchDefinition* def = PatchRegistry::getPatch(argv[i]);
+    if(def == NULL){
+      fprintf(stderr, "unknown patch: %s\n", argv[i]);
+      return 1;
+    }
+    patches.push_back(def);
+  }
+  if(patches.empty())
+    for(int i=0; i<PatchRegistry::getNumberOfPatches(); i++)
+      patches.push_back(PatchRegistry::getPatch(i));
+
+  static const char* signals[] = { "noise", "burst" };
+  int failures = 0;
+  for(size_t p=0; p<patches.size(); p++){
+    bool failed = false;
+    for(int t=0; !failed && ParameterSchedule::getTrajectoryName(t); t++){
+      for(int s=0; !failed && s<2; s++){
+	const char* trajectory = ParameterSchedule::getTrajectoryName(t);
+	RealtimeGuard::reset();
+	int block = run(patches[p], trajectory, signals[s], seconds, sampleRate, blockSize, channels);
+	if(block >= 0){
+	  printf("%-32s FAIL  block %d, %s trajectory, %s input\n",
+		 patches[p]->name, block, trajectory, signals[s]);
+	  RealtimeGuard::report(stdout, stacks);
+	  failed = true;
+	}
+      }
+    }
+    if(failed)
+      failures++;
+    else
+      printf("%-32s ok\n", patches[p]->name);
+  }
+  return failures ? 1 : 0;
+}
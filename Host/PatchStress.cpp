@@ -0,0 +1,311 @@
+/*
+ PatchStress: searches for the slowest single block of each patch.
+
+   PatchStress [options] [patch ...]
+   PatchStress -x trace.txt
+
+ Every patch is run against each combination of parameter trajectory (see
+ ParameterSchedule.h), input signal and seed, starting from a freshly
+ constructed instance. The slowest blocks found are replayed several times
+ and ranked by their fastest replay, so that a one-off interrupt or page
+ fault does not win. The winner is written as a trace holding everything
+ needed to reproduce it; -x replays such a trace.
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include "Benchmark.h"
+
+struct StressRun {
+  const PatchDefinition* patch;
+  std::string input;
+  std::string trajectory;
+  uint32_t seed;
+  double seconds;
+  double sampleRate;
+  int blockSize;
+  int channels;
+  int block;         // slowest block
+  uint64_t searchNs; // its time during the search
+  uint64_t replayNs; // fastest of the confirming replays
+  uint64_t medianNs; // median of the confirming replays
+};
+
+static std::vector<std::string> split(const char* list){
+  std::vector<std::string> items;
+  std::string item;
+  for(const char* p=list; ; p++){
+    if(*p == ',' || *p == '\0'){
+      if(!item.empty())
+	items.push_back(item);
+      item.clear();
+      if(*p == '\0')
+	break;
+    }else{
+      item += *p;
+    }
+  }
+  return items;
+}
+
+// run from a fresh instance up to 'lastBlock' (all blocks if negative)
+static uint64_t execute(StressRun& run, const ParameterSchedule& schedule, int lastBlock,
+			std::vector<uint64_t>& times){
+  AudioData input;
+  loadInput(run.input.c_str(), input, run.channels,
+	    (int)(run.seconds*run.sampleRate), run.sampleRate);
+  if(lastBlock >= 0)
+    input.length = min(input.length, (lastBlock+1)*run.blockSize);
+  PatchProcessor processor(run.sampleRate, run.blockSize);
+  processor.load(run.patch);
+  BenchmarkResult result = runBenchmark(processor, input, 0, NULL, &schedule, &times);
+  run.block = result.worstBlock;
+  return result.worstNs;
+}
+
+static void confirm(StressRun& run, const ParameterSchedule& schedule, int replays){
+  std::vector<uint64_t> samples;
+  std::vector<uint64_t> times;
+  for(int i=0; i<replays; i++){
+    int block = run.block;
+    execute(run, schedule, block, times);
+    run.block = block;
+    samples.push_back(times[block]);
+  }
+  std::sort(samples.begin(), samples.end());
+  run.replayNs = samples.front();
+  run.medianNs = samples[samples.size()/2];
+}
+
+static bool writeTrace(const char* path, StressRun& run, const ParameterSchedule& schedule){
+  FILE* out = fopen(path, "w");
+  if(out == NULL)
+    return false;
+  fprintf(out, "# PatchStress worst-case trace\n");
+  fprintf(out, "patch %s\n", run.patch->name);
+  fprintf(out, "input %s\n", run.input.c_str());
+  fprintf(out, "trajectory %s\n", run.trajectory.c_str());
+  fprintf(out, "seed %u\n", run.seed);
+  fprintf(out, "seconds %.9g\n", run.seconds);
+  fprintf(out, "samplerate %.9g\n", run.sampleRate);
+  fprintf(out, "blocksize %d\n", run.blockSize);
+  fprintf(out, "channels %d\n", run.channels);
+  fprintf(out, "block %d\n", run.block);
+  fprintf(out, "ns %llu\n", (unsigned long long)run.replayNs);
+  fprintf(out, "parameters %d\n", run.block+1);
+  schedule.write(out, run.block);
+  return fclose(out) == 0;
+}
+
+static bool readTrace(const char* path, StressRun& run, ParameterSchedule& schedule){
+  FILE* in = fopen(path, "r");
+  if(in == NULL)
+    return false;
+  char line[1024];
+  char value[1024];
+  bool ok = false;
+  run.patch = NULL;
+  while(fgets(line, sizeof(line), in)){
+    if(line[0] == '#')
+      continue;
+    char key[64];
+    if(sscanf(line, "%63s %1023s", key, value) != 2)
+      continue;
+    if(strcmp(key, "patch") == 0)
+      run.patch = PatchRegistry::getPatch(value);
+    else if(strcmp(key, "input") == 0)
+      run.input = value;
+    else if(strcmp(key, "trajectory") == 0)
+      run.trajectory = value;
+    else if(strcmp(key, "seed") == 0)
+      run.seed = strtoul(value, NULL, 10);
+    else if(strcmp(key, "seconds") == 0)
+      run.seconds = atof(value);
+    else if(strcmp(key, "samplerate") == 0)
+      run.sampleRate = atof(value);
+    else if(strcmp(key, "blocksize") == 0)
+      run.blockSize = atoi(value);
+    else if(strcmp(key, "channels") == 0)
+      run.channels = atoi(value);
+    else if(strcmp(key, "block") == 0)
+      run.block = atoi(value);
+    else if(strcmp(key, "ns") == 0)
+      run.searchNs = strtoull(value, NULL, 10);
+    else if(strcmp(key, "parameters") == 0){
+      ok = schedule.read(in);
+      break;
+    }
+  }
+  fclose(in);
+  return ok && run.patch != NULL && schedule.getBlocks() > run.block;
+}
+
+static void usage(const char* name){
+  fprintf(stderr,
+	  "usage: %s [options] [patch ...]\n"
+	  "       %s [-k replays] -x trace\n"
+	  "  -t list     trajectories, comma separated (default static,sweep,jumps,random,jitter)\n"
+	  "  -i list     input signals or files, comma separated (default noise,burst,sine,silence)\n"
+	  "  -n seeds    seeds per trajectory and input (default 4)\n"
+	  "  -s seconds  length of each run (default 2)\n"
+	  "  -r rate     sample rate in Hz (default 48000)\n"
+	  "  -b size     block size in samples (default 128)\n"
+	  "  -c channels number of channels (default 2)\n"
+	  "  -k replays  replays used to confirm a candidate (default 5)\n"
+	  "  -o dir      directory for the <patch>.wcet traces (default .)\n"
+	  "  -x trace    replay a trace written by an earlier search\n",
+	  name, name);
+}
+
+int main(int argc, char** argv){
+  std::vector<std::string> trajectories;
+  for(int i=0; ParameterSchedule::getTrajectoryName(i); i++)
+    trajectories.push_back(ParameterSchedule::getTrajectoryName(i));
+  std::vector<std::string> inputs = split("noise,burst,sine,silence");
+  int seeds = 4;
+  double seconds = 2;
+  double sampleRate = 48000;
+  int blockSize = 128;
+  int channels = 2;
+  int replays = 5;
+  const char* directory = ".";
+  const char* replayTrace = NULL;
+  int opt;
+  while((opt = getopt(argc, argv, "t:i:n:s:r:b:c:k:o:x:h")) != -1){
+    switch(opt){
+    case 't':
+      trajectories = split(optarg);
+      break;
+    case 'i':
+      inputs = split(optarg);
+      break;
+    case 'n':
+      seeds = atoi(optarg);
+      break;
+    case 's':
+      seconds = atof(optarg);
+      break;
+    case 'r':
+      sampleRate = atof(optarg);
+      break;
+    case 'b':
+      blockSize = atoi(optarg);
+      break;
+    case 'c':
+      channels = atoi(optarg);
+      break;
+    case 'k':
+      replays = max(1, atoi(optarg));
+      break;
+    case 'o':
+      directory = optarg;
+      break;
+    case 'x':
+      replayTrace = optarg;
+      break;
+    default:
+      usage(argv[0]);
+      return 1;
+    }
+  }
+  if(blockSize < 2 || channels < 1 || sampleRate <= 0 || seeds < 1){
+    usage(argv[0]);
+    return 1;
+  }
+  for(size_t i=0; i<trajectories.size(); i++){
+    if(!ParameterSchedule::isTrajectoryName(trajectories[i].c_str())){
+      fprintf(stderr, "unknown trajectory: %s\n", trajectories[i].c_str());
+      return 1;
+    }
+  }
+
+  if(replayTrace){
+    StressRun run;
+    ParameterSchedule schedule;
+    if(!readTrace(replayTrace, run, schedule)){
+      fprintf(stderr, "cannot read trace: %s\n", replayTrace);
+      return 1;
+    }
+    confirm(run, schedule, replays);
+    printf("%s block %d: recorded %.2f us, replayed min %.2f us, median %.2f us (budget %.1f us)\n",
+	   run.patch->name, run.block, run.searchNs*1e-3, run.replayNs*1e-3, run.medianNs*1e-3,
+	   BenchmarkResult::getBudgetNs(run.blockSize, run.sampleRate)*1e-3);
+    return 0;
+  }
+
+  std::vector<const PatchDefinition*> patches;
+  for(int i=optind; i<argc; i++){
+    const PatchDefinition* def = PatchRegistry::getPatch(argv[i]);
+    if(def == NULL){
+      fprintf(stderr, "unknown patch: %s\n", argv[i]);
+      return 1;
+    }
+    patches.push_back(def);
+  }
+  if(patches.empty())
+    for(int i=0; i<PatchRegistry::getNumberOfPatches(); i++)
+      patches.push_back(PatchRegistry::getPatch(i));
+
+  int blocks = (int)(seconds*sampleRate+blockSize-1)/blockSize;
+  printf("%d runs of %d blocks per patch, block size %d (budget %.1f us)\n",
+	 (int)(trajectories.size()*inputs.size())*seeds, blocks, blockSize,
+	 BenchmarkResult::getBudgetNs(blockSize, sampleRate)*1e-3);
+  printf("%-32s %10s %8s %10s %6s %8s %12s %12s\n", "patch", "trajectory", "input",
+	 "seed", "block", "found us", "replay us", "median us");
+  const int candidates = 3;
+  std::vector<uint64_t> times;
+  for(size_t p=0; p<patches.size(); p++){
+    std::vector<StressRun> worst;
+    for(size_t t=0; t<trajectories.size(); t++){
+      for(size_t i=0; i<inputs.size(); i++){
+	for(int s=0; s<seeds; s++){
+	  StressRun run;
+	  run.patch = patches[p];
+	  run.input = inputs[i];
+	  run.trajectory = trajectories[t];
+	  run.seed = 1+s;
+	  run.seconds = seconds;
+	  run.sampleRate = sampleRate;
+	  run.blockSize = blockSize;
+	  run.channels = channels;
+	  AudioData check;
+	  if(!loadInput(run.input.c_str(), check, channels, 1, sampleRate)){
+	    fprintf(stderr, "cannot read input: %s\n", run.input.c_str());
+	    return 1;
+	  }
+	  ParameterSchedule schedule;
+	  schedule.generate(run.trajectory.c_str(), run.seed, blocks);
+	  run.searchNs = execute(run, schedule, -1, times);
+	  worst.push_back(run);
+	  std::sort(worst.begin(), worst.end(), [](const StressRun& a, const StressRun& b){
+	      return a.searchNs > b.searchNs;
+	    });
+	  if(worst.size() > candidates)
+	    worst.pop_back();
+	}
+      }
+    }
+    for(size_t c=0; c<worst.size(); c++){
+      ParameterSchedule schedule;
+      schedule.generate(worst[c].trajectory.c_str(), worst[c].seed, blocks);
+      confirm(worst[c], schedule, replays);
+    }
+    std::sort(worst.begin(), worst.end(), [](const StressRun& a, const StressRun& b){
+	return a.replayNs > b.replayNs;
+      });
+    StressRun& run = worst.front();
+    printf("%-32s %10s %8s %10u %6d %8.2f %12.2f %12.2f\n", run.patch->name,
+	   run.trajectory.c_str(), run.input.c_str(), run.seed, run.block,
+	   run.searchNs*1e-3, run.replayNs*1e-3, run.medianNs*1e-3);
+    ParameterSchedule schedule;
+    schedule.generate(run.trajectory.c_str(), run.seed, blocks);
+    std::string path = std::string(directory) + "/" + run.patch->name + ".wcet";
+    if(!writeTrace(path.c_str(), run, schedule))
+      fprintf(stderr, "cannot write trace: %s\n", path.c_str());
+  }
+  return 0;
+}
@@ -0,0 +1,292 @@
+/*
+ PatchSweep: renders a patch over a grid of parameter settings and
+ measures each output, for tuning patches with many interacting knobs.
+
+   PatchSweep [options] patch
+
+ Settings are the cartesian product of the -g axes on top of the -p values:
+ '-g A=11 -g B=5 -g D=0.4:0.9:6' renders 330 settings. An axis X=steps
+ spans 0.0 to 1.0, X=low:high:steps the given range. Every setting runs
+ the same input through a fresh instance of the patch. Settings are
+ independent, so worker threads (-j, one per core by default) take the
+ next one from a shared counter until the grid is done.
+
+ One line per setting, in grid order with the first axis varying fastest:
+ the parameter values, then RMS and peak level of the output in dBFS, its
+ spectral centroid (power weighted mean frequency of the averaged Hann
+ windowed spectrum) and the number of samples at or beyond full scale,
+ which for the vowel patches is where their output clamp cut in.
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "AudioData.h"
+#include "FastFourierTransform.h"
+#include "HostClock.h"
+#include "PatchProcessor.h"
+#include "SampleBuffer.h"
+
+#define CENTROID_SIZE 2048
+#define SILENCE_DB -200.0
+
+struct GridAxis {
+  char parameter;
+  float low, high;
+  int steps;
+
+  float getValue(int step) const {
+    return steps > 1 ? low+(high-low)*step/(steps-1) : (low+high)/2;
+  }
+};
+
+struct SweepPoint {
+  double rms;      // dBFS
+  double peak;     // dBFS
+  double centroid; // Hz
+  long clips;
+};
+
+struct SweepSettings {
+  const PatchDefinition* patch;
+  std::vector<const char*> parameters;
+  std::vector<GridAxis> grid;
+  int blockSize;
+  int channel;
+  AudioData input;
+};
+
+static double toDecibels(double value){
+  return value > 0 ? 20*log10(value) : SILENCE_DB;
+}
+
+// averages the power spectra of consecutive Hann windowed frames
+class CentroidAnalyser {
+private:
+  FastFourierTransform fft;
+  FloatArray frame;
+  ComplexFloatArray spectrum;
+  std::vector<float> window;
+  std::vector<double> power;
+  int fill;
+public:
+  CentroidAnalyser() : window(CENTROID_SIZE), power(CENTROID_SIZE/2+1), fill(0) {
+    fft.init(CENTROID_SIZE);
+    frame = FloatArray::create(CENTROID_SIZE);
+    spectrum = ComplexFloatArray::create(CENTROID_SIZE);
+    for(int i=0; i<CENTROID_SIZE; i++)
+      window[i] = 0.5-0.5*cos(2*M_PI*i/CENTROID_SIZE);
+  }
+  ~CentroidAnalyser(){
+    FloatArray::destroy(frame);
+    ComplexFloatArray::destroy(spectrum);
+  }
+  void reset(){
+    std::fill(power.begin(), power.end(), 0.0);
+    fill = 0;
+  }
+  void add(const float* samples, int length){
+    for(int i=0; i<length; i++){
+      frame[fill] = samples[i]*window[fill];
+      if(++fill == CENTROID_SIZE){
+	fft.fft(frame, spectrum);
+	for(int k=0; k<=CENTROID_SIZE/2; k++)
+	  power[k] += (double)spectrum[k].re*spectrum[k].re+(double)spectrum[k].im*spectrum[k].im;
+	fill = 0;
+      }
+    }
+  }
+  // the trailing partial frame is left out; 0 for silence or short inputs
+  double getCentroid(double sampleRate){
+    double weighted = 0, total = 0;
+    for(int k=1; k<=CENTROID_SIZE/2; k++){
+      weighted += k*power[k];
+      total += power[k];
+    }
+    return total > 0 ? weighted/total*sampleRate/CENTROID_SIZE : 0;
+  }
+};
+
+static void measure(int n, const SweepSettings& settings, CentroidAnalyser& analyser,
+		    SampleBuffer& buffer, SweepPoint& point){
+  const AudioData& input = settings.input;
+  PatchProcessor processor(input.sampleRate, settings.blockSize);
+  processor.load(settings.patch);
+  for(size_t p=0; p<settings.parameters.size(); p++)
+    processor.setParameter(settings.parameters[p]);
+  for(size_t i=0; i<settings.grid.size(); i++){
+    const GridAxis& axis = settings.grid[i];
+    processor.setParameterValue((PatchParameterId)(axis.parameter-'A'), axis.getValue(n % axis.steps));
+    n /= axis.steps;
+  }
+  std::vector<float*> in(input.channels);
+  for(int ch=0; ch<input.channels; ch++)
+    in[ch] = const_cast<AudioData&>(input).getChannel(ch);
+  double sum = 0;
+  float peak = 0;
+  long clips = 0;
+  analyser.reset();
+  for(int pos=0; pos<input.length; pos += settings.blockSize){
+    int length = min(settings.blockSize, input.length-pos);
+    buffer.load(&in[0], pos, length);
+    processor.process(buffer);
+    float* out = buffer.getSamples(settings.channel);
+    for(int i=0; i<length; i++){
+      float v = fabsf(out[i]);
+      sum += (double)v*v;
+      peak = max(peak, v);
+      if(v >= 1.0f)
+	clips++;
+    }
+    analyser.add(out, length);
+  }
+  point.rms = toDecibels(sqrt(sum/input.length));
+  point.peak = toDecibels(peak);
+  point.centroid = analyser.getCentroid(input.sampleRate);
+  point.clips = clips;
+}
+
+static void work(std::atomic<int>& next, int points, const SweepSettings& settings,
+		 std::vector<SweepPoint>& results){
+  CentroidAnalyser analyser;
+  SampleBuffer buffer(settings.input.channels, settings.blockSize);
+  for(int n = next++; n < points; n = next++)
+    measure(n, settings, analyser, buffer, results[n]);
+}
+
+static bool parseAxis(const char* spec, GridAxis& axis){
+  axis.parameter = spec[0];
+  axis.low = 0;
+  axis.high = 1;
+  if(axis.parameter < 'A' || axis.parameter > 'H' || spec[1] != '=')
+    return false;
+  if(strchr(spec, ':') == NULL)
+    axis.steps = atoi(spec+2);
+  else if(sscanf(spec+2, "%f:%f:%d", &axis.low, &axis.high, &axis.steps) != 3)
+    return false;
+  return axis.steps >= 1 && axis.low >= 0 && axis.high <= 1;
+}
+
+static void usage(const char* name){
+  fprintf(stderr,
+	  "usage: %s [options] patch\n"
+	  "  -g X=steps  sweep parameter X (A to H) over 'steps' values from 0.0 to 1.0\n"
+	  "  -g X=low:high:steps  sweep parameter X over the given range\n"
+	  "  -p X=value  set parameter X for every setting (default 0.5)\n"
+	  "  -i input    noise, sine, sweep, impulse, silence, burst, or a .wav or raw file (default noise)\n"
+	  "  -n seconds  input length (default 1)\n"
+	  "  -j threads  worker threads (default one per core)\n"
+	  "  -c channel  output channel to measure (default 0)\n"
+	  "  -r rate     sample rate in Hz (default 48000)\n"
+	  "  -b size     block size in samples (default 128)\n",
+	  name);
+}
+
+int main(int argc, char** argv){
+  SweepSettings settings;
+  settings.blockSize = 128;
+  settings.channel = 0;
+  const char* inputSpec = "noise";
+  double seconds = 1;
+  double sampleRate = 48000;
+  int threads = std::thread::hardware_concurrency();
+  int opt;
+  while((opt = getopt(argc, argv, "g:p:i:n:j:c:r:b:h")) != -1){
+    switch(opt){
+    case 'g': {
+      GridAxis axis;
+      if(!parseAxis(optarg, axis)){
+	fprintf(stderr, "bad grid: %s\n", optarg);
+	return 1;
+      }
+      settings.grid.push_back(axis);
+      break;
+    }
+    case 'p':
+      settings.parameters.push_back(optarg);
+      break;
+    case 'i':
+      inputSpec = optarg;
+      break;
+    case 'n':
+      seconds = atof(optarg);
+      break;
+    case 'j':
+      threads = atoi(optarg);
+      break;
+    case 'c':
+      settings.channel = atoi(optarg);
+      break;
+    case 'r':
+      sampleRate = atof(optarg);
+      break;
+    case 'b':
+      settings.blockSize = atoi(optarg);
+      break;
+    default:
+      usage(argv[0]);
+      return 1;
+    }
+  }
+  if(optind != argc-1 || settings.blockSize < 2 || sampleRate <= 0 || seconds <= 0 ||
+     settings.channel < 0){
+    usage(argv[0]);
+    return 1;
+  }
+  settings.patch = PatchRegistry::getPatch(argv[optind]);
+  if(settings.patch == NULL){
+    fprintf(stderr, "unknown patch: %s\n", argv[optind]);
+    return 1;
+  }
+  PatchProcessor check(sampleRate, settings.blockSize);
+  for(size_t p=0; p<settings.parameters.size(); p++){
+    if(!check.setParameter(settings.parameters[p])){
+      fprintf(stderr, "bad parameter: %s\n", settings.parameters[p]);
+      return 1;
+    }
+  }
+  int channels = max(2, settings.channel+1);
+  if(!loadInput(inputSpec, settings.input, channels, (int)(seconds*sampleRate), sampleRate)){
+    fprintf(stderr, "cannot read input: %s\n", inputSpec);
+    return 1;
+  }
+
+  int points = 1;
+  for(size_t i=0; i<settings.grid.size(); i++)
+    points *= settings.grid[i].steps;
+  threads = max(1, min(threads, points));
+  std::vector<SweepPoint> results(points);
+  std::atomic<int> next(0);
+  std::vector<std::thread> workers;
+  uint64_t start = getNanoseconds();
+  for(int t=0; t<threads; t++)
+    workers.push_back(std::thread(work, std::ref(next), points, std::cref(settings),
+				  std::ref(results)));
+  for(int t=0; t<threads; t++)
+    workers[t].join();
+  double wall = (getNanoseconds()-start)*1e-9;
+
+  printf("%6s", "n");
+  for(size_t i=0; i<settings.grid.size(); i++)
+    printf(" %6c", settings.grid[i].parameter);
+  printf(" %8s %8s %10s %8s\n", "rms dB", "peak dB", "centroid", "clips");
+  for(int n=0; n<points; n++){
+    printf("%6d", n);
+    for(size_t i=0, index=n; i<settings.grid.size(); i++){
+      const GridAxis& axis = settings.grid[i];
+      printf(" %6.3f", axis.getValue(index % axis.steps));
+      index /= axis.steps;
+    }
+    const SweepPoint& point = results[n];
+    printf(" %8.2f %8.2f %10.1f %8ld\n", point.rms, point.peak, point.centroid, point.clips);
+  }
+  printf("%s: %d settings of %.1f s %s in %.2f s on %d threads (%.1f settings/s)\n",
+	 settings.patch->name, points, settings.input.length/sampleRate, inputSpec, wall,
+	 threads, points/wall);
+  return 0;
+}
@@ -0,0 +1,167 @@
+/*
+ PatchTail: what a silent tail costs, with the denormal guard of
+ ../DenormalGuard.h on and off.
+
+   PatchTail [options] [patch ...]
+
+ Each patch gets -e seconds of noise and then -s seconds of digital
+ silence, twice: once with flush-to-zero off, so that the filter states
+ decay through the subnormal range, as the other host tools run, and
+ once with it on. The report gives the cost per sample of the loud
+ part, of the tail in both runs and of the tail's slowest second, and
+ how many output samples of the unguarded run were subnormal.
+
+ Built with DENORMAL_INJECTION=1 (Build-inject/), the patches add their
+ noise floor to the input, and the unguarded run shows what that alone
+ does on a target without flush-to-zero.
+*/
+
+#include <stdio.h>
+#include <math.h>
+#include <unistd.h>
+#include <vector>
+#include "Benchmark.h"
+
+#define SKIP_BLOCKS 16 // start-up blocks left out of the loud figure
+
+struct TailResult {
+  double loudNs;       // per sample, the noise part
+  double tailNs;       // per sample, the silent part
+  double worstNs;      // per sample, the tail's slowest second
+  long subnormals;     // subnormal output samples in the tail
+};
+
+static bool runTail(const PatchDefinition* def, AudioData& input, int loudLength,
+		    int blockSize, bool flush, std::vector<const char*>& parameters,
+		    TailResult& result){
+  PatchProcessor processor(input.sampleRate, blockSize);
+  processor.load(def);
+  processor.setFlushDenormals(flush);
+  for(size_t p=0; p<parameters.size(); p++){
+    if(!processor.setParameter(parameters[p])){
+      fprintf(stderr, "bad parameter: %s\n", parameters[p]);
+      return false;
+    }
+  }
+  AudioData output;
+  std::vector<uint64_t> blockNs;
+  runBenchmark(processor, input, 0, &output, NULL, &blockNs);
+  int loudBlocks = loudLength/blockSize;
+  int secondBlocks = (int)(input.sampleRate/blockSize);
+  uint64_t loud = 0, tail = 0, second = 0, worst = 0;
+  for(int b=0; b<(int)blockNs.size(); b++){
+    if(b < loudBlocks){
+      if(b >= SKIP_BLOCKS)
+	loud += blockNs[b];
+      continue;
+    }
+    tail += blockNs[b];
+    second += blockNs[b];
+    if((b-loudBlocks+1)%secondBlocks == 0){
+      worst = second > worst ? second : worst;
+      second = 0;
+    }
+  }
+  int tailBlocks = (int)blockNs.size()-loudBlocks;
+  result.loudNs = (double)loud/((loudBlocks-SKIP_BLOCKS)*(double)blockSize);
+  result.tailNs = (double)tail/(tailBlocks*(double)blockSize);
+  result.worstNs = (double)worst/(secondBlocks*(double)blockSize);
+  result.subnormals = 0;
+  for(int ch=0; ch<output.channels; ch++){
+    const float* samples = output.getChannel(ch);
+    for(int i=loudBlocks*blockSize; i<output.length; i++)
+      if(fpclassify(samples[i]) == FP_SUBNORMAL)
+	result.subnormals++;
+  }
+  return true;
+}
+
+static void usage(const char* name){
+  fprintf(stderr,
+	  "usage: %s [options] [patch ...]\n"
+	  "  -e seconds  noise before the tail (default 1)\n"
+	  "  -s seconds  length of the silent tail (default 10)\n"
+	  "  -r rate     sample rate in Hz (default 48000)\n"
+	  "  -b size     block size in samples (default 128)\n"
+	  "  -c channels number of channels (default 2)\n"
+	  "  -p X=value  set parameter X (A to H) to value, 0.0 to 1.0 (default 0.5)\n",
+	  name);
+}
+
+int main(int argc, char** argv){
+  double loudSeconds = 1;
+  double tailSeconds = 10;
+  double sampleRate = 48000;
+  int blockSize = 128;
+  int channels = 2;
+  std::vector<const char*> parameters;
+  int opt;
+  while((opt = getopt(argc, argv, "e:s:r:b:c:p:h")) != -1){
+    switch(opt){
+    case 'e':
+      loudSeconds = atof(optarg);
+      break;
+    case 's':
+      tailSeconds = atof(optarg);
+      break;
+    case 'r':
+      sampleRate = atof(optarg);
+      break;
+    case 'b':
+      blockSize = atoi(optarg);
+      break;
+    case 'c':
+      channels = atoi(optarg);
+      break;
+    case 'p':
+      parameters.push_back(optarg);
+      break;
+    default:
+      usage(argv[0]);
+      return 1;
+    }
+  }
+  int loudLength = (int)(loudSeconds*sampleRate)/blockSize*blockSize;
+  int tailLength = (int)(tailSeconds*sampleRate)/blockSize*blockSize;
+  if(blockSize < 2 || channels < 1 || sampleRate <= 0 ||
+     loudLength < (SKIP_BLOCKS+1)*blockSize || tailSeconds < 1){
+    usage(argv[0]);
+    return 1;
+  }
+
+  std::vector<const PatchDefinition*> patches;
+  for(int i=optind; i<argc; i++){
+    const PatchDefinition* def = PatchRegistry::getPatch(argv[i]);
+    if(def == NULL){
+      fprintf(stderr, "unknown patch: %s\n", argv[i]);
+      return 1;
+    }
+    patches.push_back(def);
+  }
+  if(patches.empty())
+    for(int i=0; i<PatchRegistry::getNumberOfPatches(); i++)
+      patches.push_back(PatchRegistry::getPatch(i));
+
+  AudioData input;
+  generateSignal("noise", input, channels, loudLength+tailLength, sampleRate);
+  for(int ch=0; ch<channels; ch++)
+    for(int i=loudLength; i<input.length; i++)
+      input.getChannel(ch)[i] = 0.f;
+
+  printf("%.1f s noise then %.1f s silence, %d channels at %.0f Hz, block size %d, "
+	 "noise injection %s\n", loudLength/sampleRate, tailLength/sampleRate, channels,
+	 sampleRate, blockSize, DENORMAL_INJECTION ? "on" : "off");
+  printf("%-32s %10s %10s %10s %10s %8s %12s\n", "", "loud", "tail", "worst s", "tail",
+	 "", "subnormal");
+  printf("%-32s %10s %10s %10s %10s %8s %12s\n", "patch", "ns/sample", "no FTZ", "no FTZ",
+	 "FTZ", "no FTZ", "outputs");
+  for(size_t i=0; i<patches.size(); i++){
+    TailResult off, on;
+    if(!runTail(patches[i], input, loudLength, blockSize, false, parameters, off) ||
+       !runTail(patches[i], input, loudLength, blockSize, true, parameters, on))
+      return 1;
+    printf("%-32s %10.2f %10.2f %10.2f %10.2f %7.1fx %12ld\n", patches[i]->name,
+	   on.loudNs, off.tailNs, off.worstNs, on.tailNs, off.worstNs/on.tailNs, off.subnormals);
+  }
+  return 0;
+}
@@ -0,0 +1,296 @@
+#include "RealtimeGuard.h"
+#include <dlfcn.h>
+#include <execinfo.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <semaphore.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+extern "C" {
+  void* __libc_malloc(size_t size);
+  void* __libc_calloc(size_t count, size_t size);
+  void* __libc_realloc(void* ptr, size_t size);
+  void __libc_free(void* ptr);
+}
+
+#define MAX_VIOLATIONS 64
+#define MAX_DEPTH 24
+
+struct Violation {
+  const char* call;
+  int depth;
+  void* stack[MAX_DEPTH];
+};
+
+static Violation violations[MAX_VIOLATIONS];
+static volatile int numberOfViolations = 0;
+static volatile int numberOfAllocations = 0;
+static volatile size_t allocatedBytes = 0;
+
+static thread_local bool armed = false;
+static thread_local bool recording = false;
+
+// called on entry to every interposed function
+__attribute__((noinline)) static void check(const char* call, bool allocates = false, size_t bytes = 0){
+  if(!armed || recording)
+    return;
+  recording = true;
+  if(allocates){
+    __sync_fetch_and_add(&numberOfAllocations, 1);
+    __sync_fetch_and_add(&allocatedBytes, bytes);
+  }
+  int index = __sync_fetch_and_add(&numberOfViolations, 1);
+  if(index < MAX_VIOLATIONS){
+    violations[index].call = call;
+    violations[index].depth = backtrace(violations[index].stack, MAX_DEPTH);
+  }
+  recording = false;
+}
+
+#define REAL(name) \
+  static decltype(&::name) real = (decltype(&::name))dlsym(RTLD_NEXT, #name)
+
+bool RealtimeGuard::selfTest(){
+  // backtrace() loads its unwinder, with allocations, on first use
+  void* stack[4];
+  backtrace(stack, 4);
+  reset();
+  arm();
+  void* volatile ptr = malloc(16);
+  disarm();
+  free(ptr);
+  bool caught = getViolations() == 1;
+  reset();
+  return caught;
+}
+
+void RealtimeGuard::arm(){
+  armed = true;
+}
+
+void RealtimeGuard::disarm(){
+  armed = false;
+}
+
+int RealtimeGuard::getViolations(){
+  return numberOfViolations;
+}
+
+int RealtimeGuard::getAllocations(){
+  return numberOfAllocations;
+}
+
+size_t RealtimeGuard::getAllocatedBytes(){
+  return allocatedBytes;
+}
+
+void RealtimeGuard::reset(){
+  numberOfViolations = 0;
+  numberOfAllocations = 0;
+  allocatedBytes = 0;
+}
+
+void RealtimeGuard::report(FILE* out, int limit){
+  int count = numberOfViolations < MAX_VIOLATIONS ? numberOfViolations : MAX_VIOLATIONS;
+  for(int i=0; i<count && i<limit; i++){
+    fprintf(out, "  %s called on the audio thread:\n", violations[i].call);
+    fflush(out);
+    // skip check() and the interposed function itself
+    backtrace_symbols_fd(violations[i].stack+2, violations[i].depth-2, fileno(out));
+  }
+  if(numberOfViolations > limit)
+    fprintf(out, "  ... %d more\n", numberOfViolations-limit);
+}
+
+/* heap */
+
+extern "C" void* malloc(size_t size) noexcept {
+  check("malloc", true, size);
+  return __libc_malloc(size);
+}
+
+extern "C" void* calloc(size_t count, size_t size) noexcept {
+  check("calloc", true, count*size);
+  return __libc_calloc(count, size);
+}
+
+extern "C" void* realloc(void* ptr, size_t size) noexcept {
+  check("realloc", true, size);
+  return __libc_realloc(ptr, size);
+}
+
+extern "C" void free(void* ptr) noexcept {
+  if(ptr)
+    check("free");
+  __libc_free(ptr);
+}
+
+extern "C" int posix_memalign(void** ptr, size_t alignment, size_t size) noexcept {
+  REAL(posix_memalign);
+  check("posix_memalign", true, size);
+  return real(ptr, alignment, size);
+}
+
+extern "C" void* aligned_alloc(size_t alignment, size_t size) noexcept {
+  REAL(aligned_alloc);
+  check("aligned_alloc", true, size);
+  return real(alignment, size);
+}
+
+extern "C" void* mmap(void* addr, size_t length, int prot, int flags, int fd, off_t offset) noexcept {
+  REAL(mmap);
+  check("mmap");
+  return real(addr, length, prot, flags, fd, offset);
+}
+
+extern "C" int munmap(void* addr, size_t length) noexcept {
+  REAL(munmap);
+  check("munmap");
+  return real(addr, length);
+}
+
+/* locks */
+
+extern "C" int pthread_mutex_lock(pthread_mutex_t* mutex) noexcept {
+  REAL(pthread_mutex_lock);
+  check("pthread_mutex_lock");
+  return real(mutex);
+}
+
+extern "C" int pthread_mutex_trylock(pthread_mutex_t* mutex) noexcept {
+  REAL(pthread_mutex_trylock);
+  check("pthread_mutex_trylock");
+  return real(mutex);
+}
+
+extern "C" int pthread_mutex_unlock(pthread_mutex_t* mutex) noexcept {
+  REAL(pthread_mutex_unlock);
+  check("pthread_mutex_unlock");
+  return real(mutex);
+}
+
+extern "C" int pthread_cond_wait(pthread_cond_t* cond, pthread_mutex_t* mutex) {
+  REAL(pthread_cond_wait);
+  check("pthread_cond_wait");
+  return real(cond, mutex);
+}
+
+extern "C" int pthread_cond_signal(pthread_cond_t* cond) noexcept {
+  REAL(pthread_cond_signal);
+  check("pthread_cond_signal");
+  return real(cond);
+}
+
+extern "C" int pthread_cond_broadcast(pthread_cond_t* cond) noexcept {
+  REAL(pthread_cond_broadcast);
+  check("pthread_cond_broadcast");
+  return real(cond);
+}
+
+extern "C" int sem_wait(sem_t* sem) {
+  REAL(sem_wait);
+  check("sem_wait");
+  return real(sem);
+}
+
+extern "C" int sem_post(sem_t* sem) noexcept {
+  REAL(sem_post);
+  check("sem_post");
+  return real(sem);
+}
+
+/* I/O and sleeping */
+
+extern "C" ssize_t read(int fd, void* buf, size_t count) {
+  REAL(read);
+  check("read");
+  return real(fd, buf, count);
+}
+
+extern "C" ssize_t write(int fd, const void* buf, size_t count) {
+  REAL(write);
+  check("write");
+  return real(fd, buf, count);
+}
+
+extern "C" int open(const char* path, int flags, ...) {
+  REAL(open);
+  check("open");
+  va_list args;
+  va_start(args, flags);
+  mode_t mode = (flags & O_CREAT) ? va_arg(args, int) : 0;
+  va_end(args);
+  return real(path, flags, mode);
+}
+
+extern "C" int close(int fd) {
+  REAL(close);
+  check("close");
+  return real(fd);
+}
+
+extern "C" FILE* fopen(const char* path, const char* mode) {
+  REAL(fopen);
+  check("fopen");
+  return real(path, mode);
+}
+
+extern "C" size_t fwrite(const void* ptr, size_t size, size_t count, FILE* stream) {
+  REAL(fwrite);
+  check("fwrite");
+  return real(ptr, size, count, stream);
+}
+
+extern "C" int printf(const char* format, ...) {
+  check("printf");
+  va_list args;
+  va_start(args, format);
+  int result = vfprintf(stdout, format, args);
+  va_end(args);
+  return result;
+}
+
+extern "C" int fprintf(FILE* stream, const char* format, ...) {
+  check("fprintf");
+  va_list args;
+  va_start(args, format);
+  int result = vfprintf(stream, format, args);
+  va_end(args);
+  return result;
+}
+
+extern "C" int puts(const char* s) {
+  REAL(puts);
+  check("puts");
+  return real(s);
+}
+
+extern "C" int nanosleep(const struct timespec* req, struct timespec* rem) {
+  REAL(nanosleep);
+  check("nanosleep");
+  return real(req, rem);
+}
+
+extern "C" int usleep(useconds_t usec) {
+  REAL(usleep);
+  check("usleep");
+  return real(usec);
+}
+
+extern "C" unsigned int sleep(unsigned int seconds) {
+  REAL(sleep);
+  check("sleep");
+  return real(seconds);
+}
+
+extern "C" int sched_yield(void) noexcept {
+  REAL(sched_yield);
+  check("sched_yield");
+  return real();
+}
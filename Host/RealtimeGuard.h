@@ -0,0 +1,39 @@
+/*
+ Catches calls that have no place on the audio thread: heap allocation,
+ mutex and condition variable operations, blocking I/O and sleeps.
+
+ RealtimeGuard.cpp interposes the libc entry points (malloc, free,
+ pthread_mutex_lock, write, nanosleep, ...). Each one still forwards to
+ libc, but while the calling thread is armed it also records the call and
+ its stack. Arm around processAudio, disarm afterwards, and report.
+
+ Only link this into tools that need it (PatchSafety, PatchFootprint): the interposed
+ functions replace the libc ones for the whole program.
+*/
+
+#ifndef __RealtimeGuard_h__
+#define __RealtimeGuard_h__
+
+#include <stddef.h>
+#include <stdio.h>
+
+class RealtimeGuard {
+public:
+  // true if the interposed functions are live; checks with a real malloc
+  static bool selfTest();
+
+  static void arm();
+  static void disarm();
+
+  // violations recorded since the last reset
+  static int getViolations();
+  // of those, calls that allocated heap memory
+  static int getAllocations();
+  // and the bytes they asked for
+  static size_t getAllocatedBytes();
+  // print what was called and from where, at most 'limit' stacks
+  static void report(FILE* out, int limit);
+  static void reset();
+};
+
+#endif // __RealtimeGuard_h__
@@ -0,0 +1,24 @@
+#include "SampleBuffer.h"
+
+SampleBuffer::SampleBuffer(int ch, int sz) : channels(ch), size(sz) {
+  samples = new float[channels*size]();
+}
+
+SampleBuffer::~SampleBuffer(){
+  delete[] samples;
+}
+
+void SampleBuffer::load(float** input, int offset, int length){
+  length = min(length, size);
+  for(int ch=0; ch<channels; ch++){
+    float* dest = samples+ch*size;
+    memcpy(dest, input[ch]+offset, length*sizeof(float));
+    memset(dest+length, 0, (size-length)*sizeof(float));
+  }
+}
+
+void SampleBuffer::store(float** output, int offset, int length){
+  length = min(length, size);
+  for(int ch=0; ch<channels; ch++)
+    memcpy(output[ch]+offset, samples+ch*size, length*sizeof(float));
+}
@@ -0,0 +1,35 @@
+/*
+ Host AudioBuffer: non-interleaved float channels of one block each.
+*/
+
+#ifndef __SampleBuffer_h__
+#define __SampleBuffer_h__
+
+#include "StompBox.h"
+
+class SampleBuffer : public AudioBuffer {
+private:
+  float* samples;
+  int channels;
+  int size;
+public:
+  SampleBuffer(int channels, int size);
+  ~SampleBuffer();
+  FloatArray getSamples(int channel){
+    return FloatArray(samples+channel*size, size);
+  }
+  int getChannels(){
+    return channels;
+  }
+  int getSize(){
+    return size;
+  }
+  void clear(){
+    memset(samples, 0, channels*size*sizeof(float));
+  }
+  // copy one block of non-interleaved input, zero padding past 'length'
+  void load(float** input, int offset, int length);
+  void store(float** output, int offset, int length);
+};
+
+#endif // __SampleBuffer_h__
@@ -0,0 +1,143 @@
+#include "StageProfiler.h"
+#include "HostClock.h"
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+#define MAX_STAGES 32
+
+struct StageCounts {
+  const char* name;
+  long calls;
+  uint64_t counts[NOF_COUNTERS];
+};
+
+static StageCounts stages[MAX_STAGES];
+static int numberOfStages = 0;
+static int fds[NOF_COUNTERS] = { -1, -1, -1, -1, -1 };
+static bool hardware = false;
+static const char* error = "not opened";
+
+static int openCounter(uint32_t type, uint64_t config, int group){
+  struct perf_event_attr attr;
+  memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = type;
+  attr.config = config;
+  attr.disabled = group == -1;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  attr.read_format = PERF_FORMAT_GROUP;
+  return syscall(SYS_perf_event_open, &attr, 0, -1, group, 0);
+}
+
+bool StageProfiler::open(){
+  if(hardware)
+    return true;
+  static const uint32_t types[NOF_COUNTERS] = {
+    PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HW_CACHE,
+    PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE
+  };
+  static const uint64_t configs[NOF_COUNTERS] = {
+    PERF_COUNT_HW_CPU_CYCLES,
+    PERF_COUNT_HW_INSTRUCTIONS,
+    PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+    (PERF_COUNT_HW_CACHE_RESULT_MISS << 16),
+    PERF_COUNT_HW_BRANCH_INSTRUCTIONS,
+    PERF_COUNT_HW_BRANCH_MISSES
+  };
+  for(int i=0; i<NOF_COUNTERS; i++){
+    fds[i] = openCounter(types[i], configs[i], i == 0 ? -1 : fds[0]);
+    if(fds[i] < 0){
+      error = strerror(errno);
+      close();
+      return false;
+    }
+  }
+  ioctl(fds[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+  ioctl(fds[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+  hardware = true;
+  error = NULL;
+  return true;
+}
+
+void StageProfiler::close(){
+  for(int i=NOF_COUNTERS-1; i>=0; i--){
+    if(fds[i] >= 0)
+      ::close(fds[i]);
+    fds[i] = -1;
+  }
+  hardware = false;
+}
+
+bool StageProfiler::hasHardwareCounters(){
+  return hardware;
+}
+
+const char* StageProfiler::getError(){
+  return error;
+}
+
+int StageProfiler::getStageId(const char* name){
+  for(int i=0; i<numberOfStages; i++)
+    if(strcmp(stages[i].name, name) == 0)
+      return i;
+  if(numberOfStages == MAX_STAGES)
+    return MAX_STAGES-1; // overflow shares the last slot
+  memset(&stages[numberOfStages], 0, sizeof(StageCounts));
+  stages[numberOfStages].name = name;
+  return numberOfStages++;
+}
+
+void StageProfiler::reset(){
+  for(int i=0; i<numberOfStages; i++){
+    stages[i].calls = 0;
+    memset(stages[i].counts, 0, sizeof(stages[i].counts));
+  }
+}
+
+void StageProfiler::readCounters(uint64_t* values){
+  if(hardware){
+    uint64_t group[1+NOF_COUNTERS];
+    if(read(fds[0], group, sizeof(group)) == (ssize_t)sizeof(group)){
+      memcpy(values, group+1, NOF_COUNTERS*sizeof(uint64_t));
+      return;
+    }
+  }
+  memset(values, 0, NOF_COUNTERS*sizeof(uint64_t));
+  values[COUNTER_CYCLES] = readCycleCounter();
+}
+
+void StageProfiler::accumulate(int id, const uint64_t* begin, const uint64_t* end){
+  StageCounts& stage = stages[id];
+  stage.calls++;
+  for(int i=0; i<NOF_COUNTERS; i++)
+    stage.counts[i] += end[i]-begin[i];
+}
+
+void StageProfiler::print(FILE* out){
+  fprintf(out, "  %-34s %9s %12s %6s %12s %8s %12s %8s\n", "stage", "calls",
+	  "cycles/call", "IPC", "L1D misses", "MPKI", "br misses", "miss %");
+  for(int i=0; i<numberOfStages; i++){
+    StageCounts& stage = stages[i];
+    if(stage.calls == 0)
+      continue;
+    double cycles = stage.counts[COUNTER_CYCLES];
+    fprintf(out, "  %-34s %9ld %12.0f", stage.name, stage.calls, cycles/stage.calls);
+    if(hardware){
+      double instructions = stage.counts[COUNTER_INSTRUCTIONS];
+      double branches = stage.counts[COUNTER_BRANCHES];
+      double l1d = stage.counts[COUNTER_L1D_MISSES];
+      double misses = stage.counts[COUNTER_BRANCH_MISSES];
+      fprintf(out, " %6.2f %12.0f %8.2f %12.0f %7.2f%%\n",
+	      cycles ? instructions/cycles : 0, l1d,
+	      instructions ? 1000*l1d/instructions : 0, misses,
+	      branches ? 100*misses/branches : 0);
+    }else{
+      fprintf(out, " %6s %12s %8s %12s %8s\n", "n/a", "n/a", "n/a", "n/a", "n/a");
+    }
+  }
+}
@@ -0,0 +1,59 @@
+/*
+ Hardware performance counters per named stage, read with perf_event_open.
+
+ A stage is opened by PROFILE_STAGE() (see ../ProfileStage.h) and closed
+ at the end of the enclosing scope. Counts are inclusive: a stage that
+ calls another stage also carries its counts. When the kernel offers no
+ hardware counters (containers, most VMs) only the cycle counter from
+ HostClock.h is available and the other columns read n/a.
+
+ Single threaded: profile one patch instance at a time.
+*/
+
+#ifndef __StageProfiler_h__
+#define __StageProfiler_h__
+
+#include <stdint.h>
+#include <stdio.h>
+
+enum StageCounter {
+  COUNTER_CYCLES,
+  COUNTER_INSTRUCTIONS,
+  COUNTER_L1D_MISSES,
+  COUNTER_BRANCHES,
+  COUNTER_BRANCH_MISSES,
+  NOF_COUNTERS
+};
+
+class StageProfiler {
+public:
+  // open the counter group; false if only the cycle counter is available
+  static bool open();
+  static void close();
+  static bool hasHardwareCounters();
+  static const char* getError();
+
+  static int getStageId(const char* name);
+  static void reset();
+  static void print(FILE* out);
+
+  static void readCounters(uint64_t* values);
+  static void accumulate(int id, const uint64_t* begin, const uint64_t* end);
+};
+
+class StageScope {
+private:
+  int id;
+  uint64_t begin[NOF_COUNTERS];
+public:
+  StageScope(int stage) : id(stage) {
+    StageProfiler::readCounters(begin);
+  }
+  ~StageScope(){
+    uint64_t end[NOF_COUNTERS];
+    StageProfiler::readCounters(end);
+    StageProfiler::accumulate(id, begin, end);
+  }
+};
+
+#endif // __StageProfiler_h__
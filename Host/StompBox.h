@@ -0,0 +1,55 @@
+/*
+ Host stand-in for the OWL StompBox.h.
+
+ Implements the part of the firmware patch interface that the patches in
+ this repository use (Patch, AudioBuffer, registerParameter and
+ getParameterValue) so that they compile and run unmodified on Linux.
+ Parameter values, sample rate and block size come from the PatchProcessor
+ that created the patch.
+*/
+
+#ifndef __StompBox_h__
+#define __StompBox_h__
+
+#include "basicmaths.h"
+#include "FloatArray.h"
+#include "ComplexFloatArray.h"
+
+enum PatchParameterId {
+  PARAMETER_A,
+  PARAMETER_B,
+  PARAMETER_C,
+  PARAMETER_D,
+  PARAMETER_E,
+  PARAMETER_F,
+  PARAMETER_G,
+  PARAMETER_H
+};
+
+#define NOF_PARAMETERS 8
+
+class AudioBuffer {
+public:
+  virtual ~AudioBuffer(){}
+  virtual FloatArray getSamples(int channel) = 0;
+  virtual int getChannels() = 0;
+  virtual int getSize() = 0;
+  virtual void clear() = 0;
+};
+
+class PatchProcessor;
+
+class Patch {
+public:
+  Patch();
+  virtual ~Patch();
+  void registerParameter(PatchParameterId pid, const char* name, const char* description = "");
+  float getParameterValue(PatchParameterId pid);
+  int getBlockSize();
+  double getSampleRate();
+  virtual void processAudio(AudioBuffer& output) = 0;
+private:
+  PatchProcessor* processor;
+};
+
+#endif // __StompBox_h__
@@ -0,0 +1,26 @@
+/*
+ Host stand-in for the OWL basicmaths.h: pulls in the C maths library and
+ provides the min() / max() helpers the patches call unqualified.
+*/
+
+#ifndef __basicmaths_h__
+#define __basicmaths_h__
+
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+// the firmware defines these as macros; templates keep mixed float/double
+// calls such as max(0.0, min(1.0, lfo_val)) working without leaking a macro
+template<typename A, typename B>
+inline auto min(A a, B b) -> decltype(a+b) { return a < b ? a : b; }
+
+template<typename A, typename B>
+inline auto max(A a, B b) -> decltype(a+b) { return a > b ? a : b; }
+
+#endif // __basicmaths_h__
@@ -35,29 +35,56 @@
 #ifndef __ParametricEqPatch_hpp__
 #define __ParametricEqPatch_hpp__
 
+#include "ProfileStage.h"
+#include "BiquadLanes.h"
+#include "CoeffsCache.h"
+#include "FastMath.h"
+#include "BiquadLookahead.h"
+#include "BiquadBank.h"
+#include "DenormalGuard.h"
+#include "BiquadQ31.h"
+
+#ifndef EQ_CHANNELS
+#define EQ_CHANNELS 2 // stereo on the pedal; hosts may build for more
+#endif
+#ifndef EQ_TOPOLOGY
+#define EQ_TOPOLOGY DF1 // or TDF2, see BiquadLanes.h
+#endif
+#ifndef EQ_LOOKAHEAD
+#if defined(__SSE2__) || defined(__ARM_NEON)
+#define EQ_LOOKAHEAD 4 // samples per step of the mono kernel, see BiquadLookahead.h
+#else
+#define EQ_LOOKAHEAD 0 // no float vectors: mono runs sample by sample
+#endif
+#endif
+#ifndef EQ_INTERPOLATE
+#define EQ_INTERPOLATE 0 // 1 ramps the coefficients across each block
+#endif
+#ifndef EQ_FIXED_POINT
+#define EQ_FIXED_POINT 0 // 1: the filters run in Q31, see BiquadQ31.h
+#endif
+
 /**
- * Biquad Parametric EQ filter class
+ * Biquad Parametric EQ filter class: the design, which a BiquadBank runs
+ * on every channel
  */
 class Biquad1 {
 public:
   Biquad1() {}
   ~Biquad1() {}
-    
-  void initStateVariables(){
-        x1=0.f;
-        x2=0.f;
-        y1=0.f;
-        y2=0.f;
-    }
-    
+
   void setCoeffsPEQ(float normalizedFrequency, float Q, float dbGain) {
-    // Compute the filters coefficients a[i] and b[i];
-    float omega, c, alpha, d, gamma;
+    // Compute the filters coefficients a[i] and b[i], unless the inputs
+    // are within knob noise of the last design
+    if(cache.matches(normalizedFrequency, Q, dbGain))
+      return;
+    float omega, c, s, alpha, d, gamma, g;
     omega = 2*M_PI*normalizedFrequency ;
-    c = cosf(omega) ;
-    alpha = sinf(omega)/(2*Q);
-    d = powf(10,dbGain/40);
-    gamma = alpha*powf(10,fabsf(dbGain)/40);
+    fastSinCos(omega, &s, &c) ;
+    alpha = s/(2*Q);
+    g = fastPow10(fabsf(dbGain)/40); // 10^(|dB|/40)
+    d = dbGain < 0 ? 1/g : g;
+    gamma = alpha*g;
       
     a[0] = 1+gamma/d;
     a[1] = -2*c/a[0];
@@ -67,42 +94,25 @@ public:
     b[2] = (1-gamma*d)/a[0];
     a[0] = 1.0;
   }
-    
-  void process(int numSamples, float* input, float* out){
-    // process a block of more than 2 samples. Basic implementation without coeffs interpolation.
-    out[0] = b[0]*input[0]+b[1]*x1+b[2]*x2-a[1]*y1-a[2]*y2 ;
-    out[1] = b[0]*input[1]+b[1]*input[0]+b[2]*x1-a[1]*out[0]-a[2]*y1 ;
-    for(int i=2; i<numSamples; i++){
-      out[i] = b[0]*input[i]+b[1]*input[i-1]+b[2]*input[i-2]-a[1]*out[i-1]-a[2]*out[i-2] ;
-    }
-      
-    // store values for next block
-    x1 = input[numSamples-1];
-    x2 = input[numSamples-2];
-    y1 = out[numSamples-1];
-    y2 = out[numSamples-2];
-  }
-    
-  void process (int numSamples, float* buf){
-    float out;
-    for (int i=0;i<numSamples;i++){
-        out = b[0]*buf[i]+b[1]*x1+b[2]*x2-a[1]*y1-a[2]*y2 ;
-        y2 = y1;
-        y1 = out;
-        x2 = x1;
-        x1 = buf[i];
-        buf[i]=out;
-    }
+
+  // b0, b1, b2, a1, a2, as BiquadBank takes them
+  void getCoeffs(float* coeffs){
+    coeffs[0] = b[0];
+    coeffs[1] = b[1];
+    coeffs[2] = b[2];
+    coeffs[3] = a[1];
+    coeffs[4] = a[2];
   }
     
 private:
   float a[3] ; // ai coefficients
   float b[3] ; // bi coefficients
-  float x1, x2, y1, y2 ; // state variables to compute samples
+  CoeffsCache cache; // inputs of the current coefficients
 };
 
 /**
- * Parametric EQ OWL Patch
+ * Parametric EQ OWL Patch, the same EQ on every channel of the buffer
+ * (up to EQ_CHANNELS)
  */
 class ParametricEqPatch : public Patch {
 public:
@@ -112,8 +122,8 @@ public:
     registerParameter(PARAMETER_C, "");
     registerParameter(PARAMETER_D, "Gain", "Gain");
     registerParameter(PARAMETER_E, "FreqPedal", "FreqPedal");
-    peqL.initStateVariables();
-    peqR.initStateVariables();
+    bank.setTopology(EQ_TOPOLOGY);
+    ramping = false;
   }    
 
   void processAudio(AudioBuffer &buffer){
@@ -121,20 +131,92 @@ public:
     float fn = getFrequency()/getSampleRate();
     float Q = getQ();
     float g = getDbGain();
-    peqL.setCoeffsPEQ(fn, Q, g) ;
-    peqR.setCoeffsPEQ(fn, Q, g) ;
+    int channels = min(buffer.getChannels(), EQ_CHANNELS);
+    // with EQ_INTERPOLATE, a change is ramped in from the last block's
+    // coefficients instead of stepping at the block boundary
+    float start[5], end[5];
+    memcpy(start, bank.getCoeffs(0), sizeof(start));
+    peq.setCoeffsPEQ(fn, Q, g) ;
+    peq.getCoeffs(end);
+    bool ramp = EQ_INTERPOLATE && ramping && memcmp(start, end, sizeof(start)) != 0;
+    ramping = true;
       
-    // process
+    // process, as many channels at a time as the lanes allow
     int size = buffer.getSize();
-    float* left = buffer.getSamples(0);
-    peqL.process(size, left);
-    float* right = buffer.getSamples(1);
-    peqR.process(size, right);
+    float* buf[EQ_CHANNELS];
+    for(int ch=0; ch<channels; ch++){
+      buf[ch] = buffer.getSamples(ch);
+      denormals.process(buf[ch], size);
+    }
+#if EQ_FIXED_POINT
+    // in fixed point, see BiquadQ31.h; a change steps at the block
+    // boundary: the ramps are float only
+    fixed.setCoeffs(0, end);
+    fixed.process(buf, channels, size);
+    bank.setCoeffs(0, end);
+#else
+    if(ramp){
+      bank.processRamp(buf, channels, size, start, end);
+      return;
+    }
+    bank.setCoeffs(0, end);
+#if EQ_LOOKAHEAD
+    // the channel left over by the lane groups on its own, EQ_LOOKAHEAD
+    // samples at a time, see BiquadLookahead.h
+    if(channels%2 == 1 && bank.getTopology() == DF1){
+      channels--;
+      bank.processLookahead(channels, lookahead, buf[channels], size);
+    }
+#endif
+    bank.process(buf, channels, size);
+#endif
+  }
+
+  // filter memory of all channels, then whether a ramp may start and the
+  // coefficients it would start from, for snapshot and restore; a TDF2
+  // filter only uses the first two entries of its four
+#if EQ_FIXED_POINT
+  static const int CHANNEL_STATE_SIZE = BiquadQ31Bank<1, EQ_CHANNELS>::STATE_SIZE;
+#else
+  static const int CHANNEL_STATE_SIZE = BiquadBank<1, EQ_CHANNELS>::STATE_SIZE;
+#endif
+  static const int STATE_SIZE = EQ_CHANNELS*CHANNEL_STATE_SIZE + 6;
+  void getStateVariables(float* state){
+    for(int ch=0; ch<EQ_CHANNELS; ch++){
+#if EQ_FIXED_POINT
+      fixed.getStateVariables(ch, state+ch*CHANNEL_STATE_SIZE);
+#else
+      bank.getStateVariables(ch, state+ch*CHANNEL_STATE_SIZE);
+#endif
+    }
+    state += EQ_CHANNELS*CHANNEL_STATE_SIZE;
+    state[0] = ramping;
+    memcpy(state+1, bank.getCoeffs(0), 5*sizeof(float));
+  }
+  void setStateVariables(const float* state){
+    for(int ch=0; ch<EQ_CHANNELS; ch++){
+#if EQ_FIXED_POINT
+      fixed.setStateVariables(ch, state+ch*CHANNEL_STATE_SIZE);
+#else
+      bank.setStateVariables(ch, state+ch*CHANNEL_STATE_SIZE);
+#endif
+    }
+    state += EQ_CHANNELS*CHANNEL_STATE_SIZE;
+    ramping = state[0] != 0;
+    bank.setCoeffs(0, state+1);
   }
     
 private:
-  Biquad1 peqL ; // PEQ filter
-  Biquad1 peqR ; // PEQ filter
+  Biquad1 peq ; // PEQ filter design
+  BiquadBank<1, EQ_CHANNELS> bank ; // its coefficients, and the memory of every channel
+#if EQ_LOOKAHEAD
+  BiquadLookahead<1, EQ_LOOKAHEAD> lookahead ;
+#endif
+#if EQ_FIXED_POINT
+  BiquadQ31Bank<1, EQ_CHANNELS> fixed ; // the same in Q31
+#endif
+  bool ramping ; // coefficients set by an earlier block, to ramp from
+  DenormalGuard denormals ;
 
   float getFrequency() {
     //float f = getParameterValue(PARAMETER_A)+getParameterValue(PARAMETER_E)/2;
@@ -35,6 +35,12 @@
 #ifndef __ParametricEqWithHighShelfPatch_hpp__
 #define __ParametricEqWithHighShelfPatch_hpp__
 
+#include "ProfileStage.h"
+#include "CoeffsCache.h"
+#include "FastMath.h"
+#include "BiquadBank.h"
+#include "DenormalGuard.h"
+
 
 enum filterType {
     PEQ, // Parametric EQ
@@ -43,28 +49,27 @@ enum filterType {
 };
 #define Q_BUTTERWORTH   0.707
 
+// the design of one section; its memory is kept by the BiquadBank that
+// runs it
 class BiquadDF1 {
 public:
     BiquadDF1() {}
     ~BiquadDF1() {}
     
-  void initStateVariables(){
-    x1=0.f;
-    x2=0.f;
-    y1=0.f;
-    y2=0.f;
-  }
-    
-  // function used for PEQ, HSH, LSH
+  // function used for PEQ, HSH, LSH; skipped while the inputs stay
+  // within knob noise of the last design
   void setCoeffs(float normalizedFrequency, float Q, float dbGain){        
-    float alpha, c, omega, d, e, gamma, beta ;        
+    if(cache.matches(normalizedFrequency, Q, dbGain))
+      return;
+    float alpha, c, s, omega, d, e, gamma, beta, g ;        
     omega = 2*M_PI*normalizedFrequency ;
-    c = cosf(omega) ;
-    alpha = sinf(omega)/(2*Q);
-    d = powf(10,dbGain/40.f);
-    gamma = alpha*powf(10,fabsf(dbGain)/40.f);
-    e = powf(10,fabsf(dbGain)/20.f);
-    beta = 2*alpha*powf(e,0.5f);        
+    fastSinCos(omega, &s, &c) ;
+    alpha = s/(2*Q);
+    g = fastPow10(fabsf(dbGain)/40.f); // d, gamma, e and beta all follow from 10^(|dB|/40)
+    d = dbGain < 0 ? 1/g : g;
+    gamma = alpha*g;
+    e = g*g;
+    beta = 2*alpha*g;        
     switch (fType)
       {
       case PEQ: // Parametric EQ
@@ -119,21 +124,13 @@ public:
       }        
   }
 
-  void copyCoeffs(BiquadDF1& other){
-    memcpy(a, other.a, sizeof(float)*3);
-    memcpy(b, other.b, sizeof(float)*3);
-  }
-
-  void process (int numSamples, float* buf){
-    float out;
-    for (int i=0;i<numSamples;i++){
-      out = b[0]*buf[i]+b[1]*x1+b[2]*x2-a[1]*y1-a[2]*y2 ;
-      y2 = y1;
-      y1 = out;
-      x2 = x1;
-      x1 = buf[i];
-      buf[i]=out;
-    }
+  // b0, b1, b2, a1, a2, as BiquadBank takes them
+  void getCoeffs(float* coeffs){
+    coeffs[0] = b[0];
+    coeffs[1] = b[1];
+    coeffs[2] = b[2];
+    coeffs[3] = a[1];
+    coeffs[4] = a[2];
   }
     
   void setType (filterType typ){
@@ -143,34 +140,31 @@ public:
 private:
     float a[3] ; // ai coefficients
     float b[3] ; // bi coefficients
-    float x1, x2, y1, y2 ; // state variables to compute samples
     filterType fType;
+    CoeffsCache cache; // inputs of the current coefficients
 };
 
 
 /**
- * Biquad Parametric EQ filter class
+ * Biquad Parametric EQ filter class: the design
  */
 class Biquad1 {
 public:
   Biquad1() {}
   ~Biquad1() {}
-    
-  void initStateVariables(){
-        x1=0.f;
-        x2=0.f;
-        y1=0.f;
-        y2=0.f;
-    }
-    
+
   void setCoeffsPEQ(float normalizedFrequency, float Q, float dbGain) {
-    // Compute the filters coefficients a[i] and b[i];
-    float omega, c, alpha, d, gamma;
+    // Compute the filters coefficients a[i] and b[i], unless the inputs
+    // are within knob noise of the last design
+    if(cache.matches(normalizedFrequency, Q, dbGain))
+      return;
+    float omega, c, s, alpha, d, gamma, g;
     omega = 2*M_PI*normalizedFrequency ;
-    c = cosf(omega) ;
-    alpha = sinf(omega)/(2*Q);
-    d = powf(10,dbGain/40);
-    gamma = alpha*powf(10,fabsf(dbGain)/40);
+    fastSinCos(omega, &s, &c) ;
+    alpha = s/(2*Q);
+    g = fastPow10(fabsf(dbGain)/40); // 10^(|dB|/40)
+    d = dbGain < 0 ? 1/g : g;
+    gamma = alpha*g;
       
     a[0] = 1+gamma/d;
     a[1] = -2*c/a[0];
@@ -180,38 +174,20 @@ public:
     b[2] = (1-gamma*d)/a[0];
     a[0] = 1.0;
   }
-    
-  void process(int numSamples, float* input, float* out){
-    // process a block of more than 2 samples. Basic implementation without coeffs interpolation.
-    out[0] = b[0]*input[0]+b[1]*x1+b[2]*x2-a[1]*y1-a[2]*y2 ;
-    out[1] = b[0]*input[1]+b[1]*input[0]+b[2]*x1-a[1]*out[0]-a[2]*y1 ;
-    for(int i=2; i<numSamples; i++){
-      out[i] = b[0]*input[i]+b[1]*input[i-1]+b[2]*input[i-2]-a[1]*out[i-1]-a[2]*out[i-2] ;
-    }
-      
-    // store values for next block
-    x1 = input[numSamples-1];
-    x2 = input[numSamples-2];
-    y1 = out[numSamples-1];
-    y2 = out[numSamples-2];
-  }
-    
-  void process (int numSamples, float* buf){
-    float out;
-    for (int i=0;i<numSamples;i++){
-        out = b[0]*buf[i]+b[1]*x1+b[2]*x2-a[1]*y1-a[2]*y2 ;
-        y2 = y1;
-        y1 = out;
-        x2 = x1;
-        x1 = buf[i];
-        buf[i]=out;
-    }
+
+  // b0, b1, b2, a1, a2, as BiquadBank takes them
+  void getCoeffs(float* coeffs){
+    coeffs[0] = b[0];
+    coeffs[1] = b[1];
+    coeffs[2] = b[2];
+    coeffs[3] = a[1];
+    coeffs[4] = a[2];
   }
     
 private:
   float a[3] ; // ai coefficients
   float b[3] ; // bi coefficients
-  float x1, x2, y1, y2 ; // state variables to compute samples
+  CoeffsCache cache; // inputs of the current coefficients
 };
 
 class FourBandsEq {
@@ -220,19 +196,15 @@ private:
     float fn1; //, fn2, fn3, fn4; // cutoffs frequencies, normalized
 public:
   FourBandsEq(double samplerate) {
-    band1.initStateVariables();
     band1.setType(HSH);
     fn1=3000/samplerate;
       
-  /*  band2.initStateVariables();
-    band2.setType(PEQ);
+  /*  band2.setType(PEQ);
     fn2=250/samplerate;
       
-    band3.initStateVariables();
     band3.setType(PEQ);
     fn3=1500/samplerate;
       
-    band4.initStateVariables();
     band4.setType(PEQ);
     fn4=4000/samplerate;*/
   }
@@ -245,19 +217,9 @@ public:
     //band4.setCoeffs(fn4, Q_BUTTERWORTH, d);
   }
 
-  void copyCoeffs(FourBandsEq& other){
-    band1.copyCoeffs(other.band1);
-    //band2.copyCoeffs(other.band2);
-    //band3.copyCoeffs(other.band3);
-    //band4.copyCoeffs(other.band4);
-  }
-
-  void process(int numSamples, float* buf){      
-    // process
-    band1.process(numSamples, buf);
-    //band2.process(numSamples, buf);
-    //band3.process(numSamples, buf);
-    //band4.process(numSamples, buf);
+  // b0, b1, b2, a1, a2 of the (one) band
+  void getCoeffs(float* coeffs){
+    band1.getCoeffs(coeffs);
   }
 };
 
@@ -266,15 +228,12 @@ public:
  */
 class ParametricEqWithHighShelfPatch : public Patch {
 public:
-  ParametricEqWithHighShelfPatch() : eqL(getSampleRate()), eqR(getSampleRate()) {
+  ParametricEqWithHighShelfPatch() : eq(getSampleRate()) {
     registerParameter(PARAMETER_A, "PE_Freq", "PE_Freq");
     registerParameter(PARAMETER_B, "PE_Q", "PE_Q");
     registerParameter(PARAMETER_C, "PE_Gain","PE_Gain");
     registerParameter(PARAMETER_D, "Treb_Gain", "Treb_Gain"); //aka "HIGH"s
     registerParameter(PARAMETER_E, "FreqPedal", "FreqPedal");
-    peqL.initStateVariables();
-    peqR.initStateVariables();
-    
   }    
      
 
@@ -285,29 +244,41 @@ public:
     float g = getDbGain();
     float a= getDbGain2(PARAMETER_D);
     
-    peqL.setCoeffsPEQ(fn, Q, g) ;
-    peqR.setCoeffsPEQ(fn, Q, g) ;
+    float coeffs[5];
+    peq.setCoeffsPEQ(fn, Q, g) ;
+    peq.getCoeffs(coeffs);
+    bank.setCoeffs(0, coeffs);
     
-    eqL.setCoeffs(a);
-    eqR.copyCoeffs(eqL);
+    eq.setCoeffs(a);
+    eq.getCoeffs(coeffs);
+    bank.setCoeffs(1, coeffs);
       
-    // process
+    // process: both channels side by side, the PEQ and the shelf as one
+    // cascade
     int size = buffer.getSize();
-    float* left = buffer.getSamples(0);
-    peqL.process(size, left);
-    float* right = buffer.getSamples(1);
-    peqR.process(size, right);
-    
-    eqL.process(size, left);
-    eqR.process(size, right);
+    float* buf[2] = { buffer.getSamples(0), buffer.getSamples(1) };
+    denormals.process(buf[0], size);
+    denormals.process(buf[1], size);
+    bank.process(buf, 2, size);
+  }
+
+  // filter memory of both channels, for snapshot and restore: per
+  // channel, that of the PEQ and then of the shelf
+  static const int STATE_SIZE = 2*BiquadBank<2, 2>::STATE_SIZE;
+  void getStateVariables(float* state){
+    bank.getStateVariables(0, state);
+    bank.getStateVariables(1, state+BiquadBank<2, 2>::STATE_SIZE);
+  }
+  void setStateVariables(const float* state){
+    bank.setStateVariables(0, state);
+    bank.setStateVariables(1, state+BiquadBank<2, 2>::STATE_SIZE);
   }
     
 private:
-  Biquad1 peqL ; // PEQ filter
-  Biquad1 peqR ; // PEQ filter
-  
-  FourBandsEq eqL;
-  FourBandsEq eqR;
+  Biquad1 peq ; // PEQ filter design
+  FourBandsEq eq; // high shelf design
+  BiquadBank<2, 2> bank; // the two, and the memory of both channels
+  DenormalGuard denormals;
 
   float getFrequency() {
     //float f = getParameterValue(PARAMETER_A)+getParameterValue(PARAMETER_E)/2;
@@ -0,0 +1,26 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/*
+ Named profiling stages for the patches.
+
+ PROFILE_STAGE("name") marks the rest of the enclosing scope as one stage.
+ On the pedal, and in normal host builds, it expands to nothing. The host
+ harness defines PROFILE_STAGES (make -C Host PROFILE_STAGES=1) to count
+ cycles, instructions, L1 data cache misses and branch misses per stage.
+*/
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __ProfileStage_h__
+#define __ProfileStage_h__
+
+#ifdef PROFILE_STAGES
+#include "StageProfiler.h"
+#define PROFILE_STAGE(name) \
+  static const int profileStageId_ = StageProfiler::getStageId(name); \
+  StageScope profileStage_(profileStageId_)
+#else
+#define PROFILE_STAGE(name)
+#endif
+
+#endif // __ProfileStage_h__
@@ -30,6 +30,9 @@
 #define __ThreeParallelBandPass_hpp__
 
 //include "SampleBasedPatch.hpp"
+#include "ProfileStage.h"
+#include "DenormalGuard.h"
+#include "FastMath.h"
 
 /**
 State variable Filter
@@ -61,6 +64,8 @@ notch = high + low;
 */
 
 class SampleBasedPatch : public Patch {
+private:
+  DenormalGuard denormals; // the SVF states, see DenormalGuard.h
 public:
   virtual void prepare() = 0;
   virtual float processSample(float sample) = 0;
@@ -68,6 +73,8 @@ public:
     prepare();
     int size = buffer.getSize();
     float* samples = buffer.getSamples(0); // This Class is Mono (1in, 1out)
+    denormals.process(samples, size);
+    PROFILE_STAGE("SVF bandpass loop");
       for(int i=0; i<size; ++i){
           samples[i] = processSample(samples[i]);
       }
@@ -109,13 +116,13 @@ public:
 	
 	float low = 50.0f / 44100.0f; 		//assumed sample rate is 44100 Hz
 	float high = 10000.0f / 44100.0f;	//assumed sample rate is 44100 Hz
-	float logScaleFac = logf(high / low);
+	float logScaleFac = fastLog(high / low);
 
 	for (int i=0; i<3; i++) {
 		//map 0.0 to 1.0 to be logarithmic between given low and high frequencies
-		fc[i] = low * expf(logScaleFac * fc[i]);
+		fc[i] = low * fastExp(logScaleFac * fc[i]);
 		
-		f[i] = sin(M_PI * fc[i]);
+		f[i] = fastSin(M_PI * fc[i]);
 	}
 
     q = 1 - q;
@@ -128,6 +135,20 @@ public:
     //return gain*low[ind];
 	return gain*band[ind];
   }	
+  //filter memory of the bandpass filters, for snapshot and restore
+  static const int STATE_SIZE = 6;
+  void getStateVariables(float* state) {
+	for (int i=0; i<3; i++) {
+		state[i] = low[i];
+		state[3+i] = band[i];
+	}
+  }
+  void setStateVariables(const float* state) {
+	for (int i=0; i<3; i++) {
+		low[i] = state[i];
+		band[i] = state[3+i];
+	}
+  }
   float processSample(float sample){
 	float out_val = 0.0;
 	for (int i=0; i<3; i++) {
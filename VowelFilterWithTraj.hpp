@@ -29,9 +29,14 @@
 #ifndef __VowelFilterWithTraj_hpp__
 #define __VowelFilterWithTraj_hpp__
 
+#include "ProfileStage.h"
+#include "DenormalGuard.h"
+
 
 
 class SampleBasedPatch : public Patch {
+private:
+  DenormalGuard denormals; // the SVF states, see DenormalGuard.h
 public:
   virtual void prepare() = 0;
   virtual float processSample(float sample) = 0;
@@ -39,6 +44,8 @@ public:
 	prepare();
 	int size = buffer.getSize();
 	float* samples = buffer.getSamples(0); // This Class is Mono (1in, 1out)
+	denormals.process(samples, size);
+	PROFILE_STAGE("SVF bandpass loop");
 	for(int i=0; i<size; ++i){
 		samples[i] = processSample(samples[i]);
 	}
@@ -164,6 +171,33 @@ class VowelFilterWithTraj : public SampleBasedPatch {
 			overall_gain = overall_gain * overall_gain;  //max gain will be 4 => 12 dB
 		}
 			
+		//filter memory of the bandpass filters, the trajectory clock and the
+		//power averager that retriggers it, for snapshot and restore
+		#define N_AVE (882*2)
+		static const int STATE_SIZE = 10 + N_AVE;
+		void getStateVariables(float* state) {
+			for (int i=0; i<3; i++) {
+				state[i] = low[i];
+				state[3+i] = band[i];
+			}
+			state[6] = time_val;
+			state[7] = ave_sum;
+			state[8] = ave_ind;
+			state[9] = was_above_thresh;
+			for (int i=0; i<n_ave; i++) state[10+i] = ave_buff[i];
+		}
+		void setStateVariables(const float* state) {
+			for (int i=0; i<3; i++) {
+				low[i] = state[i];
+				band[i] = state[3+i];
+			}
+			time_val = state[6];
+			ave_sum = state[7];
+			ave_ind = (int)state[8];
+			was_above_thresh = state[9];
+			for (int i=0; i<n_ave; i++) ave_buff[i] = state[10+i];
+		}
+		
 		float processSample(float sample){
 			//sample value should be -1.0 to +1.0
 			
@@ -257,7 +291,6 @@ class VowelFilterWithTraj : public SampleBasedPatch {
 		//const float time_speed_scale = (1.0f/44100.0f)*20.0f;  //fastest is 20 per second
 		float time_increment = (1.0f/44100.0f); //this will get overwritten in the methods
 		float time_val = 0.0f; //time since the last trigger
-		#define N_AVE (882*2)
 		const int n_ave = N_AVE;
 		float ave_buff[N_AVE];  //set for 20 msec, which should be a 50 Hz cutoff.  at 44.1kHz, that's about 882 samples
 		int ave_ind = 0;
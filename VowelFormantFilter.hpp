@@ -28,9 +28,14 @@
 #ifndef __VowelFormantFilter_hpp__
 #define __VowelFormantFilter_hpp__
 
+#include "ProfileStage.h"
+#include "DenormalGuard.h"
+
 
 
 class SampleBasedPatch : public Patch {
+private:
+  DenormalGuard denormals; // the SVF states, see DenormalGuard.h
 public:
   virtual void prepare() = 0;
   virtual float processSample(float sample) = 0;
@@ -38,6 +43,8 @@ public:
     prepare();
     int size = buffer.getSize();
     float* samples = buffer.getSamples(0); // This Class is Mono (1in, 1out)
+    denormals.process(samples, size);
+    PROFILE_STAGE("SVF bandpass loop");
 		for(int i=0; i<size; ++i){
 			samples[i] = processSample(samples[i]);
 		}
@@ -167,6 +174,12 @@ class VowelFormantFilter : public SampleBasedPatch {
 			}
 			
 			//decide if we reset the model or not
+			setModel(new_model);
+			return model;
+		}
+
+		//switch to the tables of a formant model, unless already there
+		void setModel(int new_model) {
 			if (model != new_model) {
 					 
 				model = new_model;
@@ -217,7 +230,6 @@ class VowelFormantFilter : public SampleBasedPatch {
 						break;
 				}
 			}
-			return model;
 		}
 		
 		float bandpass(float sample, int ind) {
@@ -226,6 +238,24 @@ class VowelFormantFilter : public SampleBasedPatch {
 			band[ind] = f[ind] * high + band[ind];
 			return gain[ind]*band[ind];
 		}	
+		//filter memory of the bandpass filters, and the formant model that
+		//chooseModel's hysteresis starts from, for snapshot and restore
+		static const int STATE_SIZE = 7;
+		void getStateVariables(float* state) {
+			for (int i=0; i<3; i++) {
+				state[i] = low[i];
+				state[3+i] = band[i];
+			}
+			state[6] = model;
+		}
+		void setStateVariables(const float* state) {
+			for (int i=0; i<3; i++) {
+				low[i] = state[i];
+				band[i] = state[3+i];
+			}
+			setModel((int)state[6]);
+		}
+		
 		float processSample(float sample){
 
 			float out_val = 0.0;